@@ -0,0 +1,73 @@
+/*
+  gcc -O2 admit_bench.c protocol.c -o admit_bench
+  ./admit_bench <rate> <count> <program>...
+
+  Submits count programs to a running scheduler, rate per second, taking
+  the programs given in turn. Each one is written to the pipe alone, like
+  independent interpreters would do.
+
+  The scheduler measures the admission latency of each one (from reading
+  it from the pipe to queueing its process): send it SIGHUP afterwards and
+  look at admission_latency_us_* in scheduler.stats.json. admit_bench.sh
+  does all of this for each way of creating processes.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>         // clock_nanosleep
+#include <sys/stat.h>     // mkfifo
+
+#include "protocol.h"
+
+// seconds elapsed since start
+double elapsed(struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double) (now.tv_sec - start->tv_sec) +
+         (double) (now.tv_nsec - start->tv_nsec) / 1000000000;
+}
+
+int main(int argc, char *argv[]) {
+  struct timespec start, next;
+  Batch batch = batch_create();
+
+  if(argc < 4) {
+    printf("Usage: %s <rate> <count> <program>...\n", argv[0]);
+    exit(1);
+  }
+  int rate = atoi(argv[1]);
+  int count = atoi(argv[2]);
+  int n_progs = argc - 3;
+  if(rate <= 0 || count <= 0) {
+    printf("rate and count must be positive\n");
+    exit(1);
+  }
+  long period = 1000000000L / rate;
+
+  mkfifo(PIPE_INPUT, 0666);
+  int pipe_fd = open(PIPE_INPUT, O_WRONLY);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  next = start;
+  for(int i=0; i < count; i++) {
+    char *prog = argv[3 + i % n_progs];
+    batch_add(&batch, prog, strlen(prog));
+    batch_flush(&batch, pipe_fd);
+
+    // sleep until the next submission is due, without drifting
+    next.tv_nsec += period;
+    while(next.tv_nsec >= 1000000000L) {
+      next.tv_nsec -= 1000000000L;
+      next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+  }
+
+  double secs = elapsed(&start);
+  printf("submitted %d programs in %.2f s (%.0f/s)\n", count, secs, count / secs);
+  close(pipe_fd);
+  return 0;
+}
@@ -0,0 +1,26 @@
+#!/bin/sh
+# ./admit_bench.sh [rate] [count]
+#
+# Compares the admission latency of each way of creating processes (see
+# spawner.h), submitting noop at the given rate (default 1000 per second).
+# noop is static, so that exec does not dominate the cost of each job.
+
+RATE=${1:-1000}
+COUNT=${2:-5000}
+
+make -s scheduler admit_bench noop || exit 1
+
+for args in "-f fork" "-f spawn" "-f fork -w 8" "-f spawn -w 8"; do
+  rm -f input.pipe
+  ./scheduler $args > /dev/null &
+  pid=$!
+  sleep 0.5
+  ./admit_bench $RATE $COUNT ./noop > /dev/null
+  sleep 1
+  kill -HUP $pid
+  sleep 0.5
+  kill -TERM $pid
+  wait $pid
+  printf "%-16s" "$args"
+  grep -o '"admission_latency_us_mean": [0-9.]*, "admission_latency_us_max": [0-9.]*' scheduler.stats.json
+done
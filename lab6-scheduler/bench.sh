@@ -0,0 +1,95 @@
+#!/bin/sh
+# [SCHED_ARGS=...] ./bench.sh [scenario]...   (or make bench)
+#
+# Runs the scheduler on each scenario below, until all its jobs end (-n),
+# without its console log (-l 0) and with the extra arguments in
+# SCHED_ARGS, and prints one line per scenario:
+#   jobs/s       jobs ended per second of wall time, from the submission
+#   turnaround   mean and p99, in ms, from scheduler.jobs.csv
+#   response     mean time until the first run, in ms
+#   ctx/s        context switches (dispatches) per second
+#   sched cpu    CPU used by the scheduler (all threads), as a percentage of
+#                the wall time and per job, from scheduler.stats.json
+#
+# Scenarios:
+#   short     2000 jobs of 0.2 UT of CPU, UT = 1 ms
+#   mixed     200 jobs of all kinds from wlgen (fixed seed), UT = 2 ms
+#   overload  2000 jobs of 1 UT CPU, 1 UT IO, 1 UT CPU at once, UT = 1 ms,
+#             so that thousands of processes wait in the queues, with
+#             -p stop to measure that mode too
+#   iostorm   2000 jobs that start a 100 UT IO at once, UT = 1 ms, so that
+#             thousands of IO ends reach the scheduler together. A report
+#             that is lost leaves its job waiting forever, and the scenario
+#             fails (see SIG_IO in preempt.h)
+
+SCENARIOS=${*:-short mixed overload iostorm}
+TMP=$(mktemp -d)
+trap 'rm -rf $TMP' EXIT
+
+make -s scheduler interpreter workload wlgen || exit 1
+
+# scenario -> scheduler arguments, input file and number of jobs
+setup() {
+  case $1 in
+    short)
+      ARGS="-u 1000"
+      echo "exec workload 0.2 x2000" > $TMP/input
+      ;;
+    mixed)
+      ARGS="-u 2000"
+      ./wlgen -n 200 -m all -r 1 -k 0.5 > $TMP/input
+      ;;
+    overload)
+      ARGS="-u 1000 -p stop"
+      echo "exec workload 1 1 1 x2000" > $TMP/input
+      ;;
+    iostorm)
+      ARGS="-u 1000"
+      echo "exec workload 0 100 0 x2000" > $TMP/input
+      ;;
+    *)
+      echo "unknown scenario $1"
+      exit 1
+      ;;
+  esac
+  # each line is a job, or x<copies> jobs
+  JOBS=$(awk '{ n = 1; if($NF ~ /^x[0-9]+$/) n = substr($NF, 2); total += n } END { print total }' $TMP/input)
+}
+
+# value of a number field of scheduler.stats.json
+stat() {
+  grep -o "\"$1\": [0-9.]*" scheduler.stats.json | head -1 | awk '{ print $2 }'
+}
+
+printf "%-10s %6s %8s %9s %9s %9s %9s %7s %9s\n" scenario jobs jobs/s \
+       "turn mean" "turn p99" "resp mean" ctx/s "sched%" "us/job"
+
+for s in $SCENARIOS; do
+  setup $s
+  rm -f input.pipe scheduler.stats.json scheduler.jobs.csv
+  timeout 300 ./scheduler $ARGS -l 0 $SCHED_ARGS -n $JOBS > /dev/null &
+  pid=$!
+  sleep 0.3
+
+  start=$(date +%s%N)
+  ./interpreter $TMP/input > /dev/null
+  wait $pid
+  end=$(date +%s%N)
+
+  if [ ! -f scheduler.stats.json ] || [ "$(stat ended)" != "$JOBS" ]; then
+    echo "$s: the scheduler did not end all $JOBS jobs"
+    continue
+  fi
+
+  # turnaround is the 6th column and response the 7th, in microsseconds
+  tail -n +2 scheduler.jobs.csv | cut -d, -f6,7 | sort -t, -k1 -n | awk -F, \
+      -v name=$s -v jobs=$JOBS -v wall=$(( (end - start) / 1000 )) \
+      -v ctx=$(stat context_switches) -v cpu=$(stat scheduler_cpu_us) '
+    { turn[NR] = $1; tsum += $1; rsum += $2 }
+    END {
+      p99 = turn[int(NR * 0.99 + 0.99)]
+      printf "%-10s %6d %8.0f %9.1f %9.1f %9.1f %9.0f %6.1f%% %9.0f\n", name, jobs,
+             jobs / (wall / 1e6), tsum / NR / 1000, p99 / 1000, rsum / NR / 1000,
+             ctx / (wall / 1e6), 100 * cpu / wall, cpu / jobs
+    }'
+done
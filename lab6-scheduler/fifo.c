@@ -1,6 +1,9 @@
 /*
   Simple FIFO queue example from
   https://gist.github.com/ryankurte/61f95dc71133561ed055ff62b33585f8#file-safe_queue-c
+
+  The default version is a ring buffer. Compile with -DFIFO_LIST to get
+  the original linked list version.
 */
 
 #include <stdlib.h>
@@ -8,6 +11,8 @@
 #include <stdio.h>
 #include "fifo.h"
 
+#ifdef FIFO_LIST
+
 Fifo fifo_create() {
   return (Fifo) {NULL, NULL};
 }
@@ -59,10 +64,168 @@ int fifo_take(Fifo *f) {
   return temp.data;
 }
 
+int fifo_take_last(Fifo *f) {
+  if(fifo_empty(f)) {
+    return -1;
+  }
+
+  // the list is singly linked: find the node before the last one
+  Node *prev = NULL;
+  for(Node *p = f->first; p != f->last; p = p->next) {
+    prev = p;
+  }
+  int value = f->last->data;
+  free(f->last);
+  if(prev == NULL) {
+    f->first = NULL;
+  } else {
+    prev->next = NULL;
+  }
+  f->last = prev;
+  return value;
+}
+
+int fifo_index(Fifo *f, int value) {
+  int i = 0;
+  for(Node *p = f->first; p != NULL; p = p->next, i++) {
+    if(p->data == value) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int fifo_remove(Fifo *f, int value) {
+  Node *prev = NULL;
+  for(Node *p = f->first; p != NULL; prev = p, p = p->next) {
+    if(p->data == value) {
+      // unlink p, fixing first and last if needed
+      if(prev == NULL) {
+        f->first = p->next;
+      } else {
+        prev->next = p->next;
+      }
+      if(f->last == p) {
+        f->last = prev;
+      }
+      free(p);
+      return 1;
+    }
+  }
+  return 0;
+}
+
 void fifo_free(Fifo *f) {
   while(fifo_take(f) != -1);
 }
 
+#else
+
+#define FIFO_MIN_SIZE 16  // number of slots allocated by the first fifo_put
+
+// the buffer is only allocated by the first fifo_put
+Fifo fifo_create() {
+  return (Fifo) {NULL, 0, 0, 0};
+}
+
+int fifo_empty(Fifo *f) {
+  return f->count == 0 ? 1 : 0;
+}
+
+void fifo_print(Fifo *f) {
+  if(fifo_empty(f)){
+    printf("[empty]");
+  } else {
+    printf("[");
+    for(int i=0; i < f->count-1; i++) {
+      printf("%d, ", f->data[(f->first + i) % f->size]);
+    }
+    printf("%d]", f->data[(f->first + f->count-1) % f->size]);
+  }
+}
+
+// double the buffer, moving the elements to the start of the new one
+static void fifo_grow(Fifo *f) {
+  int new_size = f->size == 0 ? FIFO_MIN_SIZE : 2*f->size;
+  int *new_data = (int*) malloc(new_size * sizeof(int));
+  assert(new_data != NULL);
+
+  for(int i=0; i < f->count; i++) {
+    new_data[i] = f->data[(f->first + i) % f->size];
+  }
+  free(f->data);
+  f->data = new_data;
+  f->size = new_size;
+  f->first = 0;
+}
+
+void fifo_put(Fifo *f, int value) {
+  if(f->count == f->size) {
+    fifo_grow(f);
+  }
+  // the slot after the last element
+  int last = f->first + f->count;
+  if(last >= f->size) {
+    last -= f->size;
+  }
+  f->data[last] = value;
+  f->count++;
+}
+
+int fifo_take(Fifo *f) {
+  if(fifo_empty(f)) {
+    // impossible to take data from an empty queue
+    return -1;
+  }
+
+  int value = f->data[f->first];
+  f->first++;
+  if(f->first == f->size) {
+    f->first = 0;
+  }
+  f->count--;
+  return value;
+}
+
+int fifo_take_last(Fifo *f) {
+  if(fifo_empty(f)) {
+    return -1;
+  }
+
+  f->count--;
+  return f->data[(f->first + f->count) % f->size];
+}
+
+int fifo_index(Fifo *f, int value) {
+  for(int i=0; i < f->count; i++) {
+    if(f->data[(f->first + i) % f->size] == value) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int fifo_remove(Fifo *f, int value) {
+  for(int i=0; i < f->count; i++) {
+    if(f->data[(f->first + i) % f->size] == value) {
+      // shift the elements after it one slot back
+      for(int j=i; j < f->count-1; j++) {
+        f->data[(f->first + j) % f->size] = f->data[(f->first + j+1) % f->size];
+      }
+      f->count--;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void fifo_free(Fifo *f) {
+  free(f->data);
+  *f = fifo_create();
+}
+
+#endif
+
 // used to test
 void fifo_test() {
   int x;
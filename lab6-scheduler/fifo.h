@@ -1,4 +1,8 @@
 
+#ifdef FIFO_LIST
+
+// linked list version: one malloc per fifo_put and one free per fifo_take
+
 typedef struct node {
   struct node *next;
   int data;
@@ -9,6 +13,21 @@ typedef struct {
   Node *last;
 } Fifo;
 
+#else
+
+// ring buffer version (default): elements live in one contiguous array
+// that only grows (doubling) when it is full, so after warming up
+// fifo_put and fifo_take never allocate
+
+typedef struct {
+  int *data;    // ring buffer with 'size' slots
+  int size;     // number of slots allocated in 'data'
+  int first;    // index of the first element
+  int count;    // number of elements in the queue
+} Fifo;
+
+#endif
+
 // returns an empty fifo queue
 Fifo fifo_create();
 
@@ -24,5 +43,17 @@ void fifo_put(Fifo *f, int value);
 // returns -1 if the queue is empty
 int fifo_take(Fifo *f);
 
+// remove and return the last element of the queue
+// returns -1 if the queue is empty
+int fifo_take_last(Fifo *f);
+
+// position of the first occurrence of value in the queue, 0 is the first
+// returns -1 if value is not in the queue
+int fifo_index(Fifo *f, int value);
+
+// remove the first occurrence of value from anywhere in the queue
+// returns 0 if value is not in the queue
+int fifo_remove(Fifo *f, int value);
+
 // free all nodes from the queue
 void fifo_free(Fifo *f);
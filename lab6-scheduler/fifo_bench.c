@@ -0,0 +1,84 @@
+/*
+  gcc -O2 fifo_bench.c fifo.c -o fifo_bench; ./fifo_bench
+  gcc -O2 -DFIFO_LIST fifo_bench.c fifo.c -o fifo_bench_list; ./fifo_bench_list
+
+  Measures fifo_put/fifo_take throughput of the version of fifo.c it was
+  compiled with. Compare the output of both binaries above.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>         // clock_gettime
+
+#include "fifo.h"
+
+#define N_OPS 10000000    // number of put+take pairs of each test
+
+// returns seconds elapsed since start
+double elapsed(struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double) (now.tv_sec - start->tv_sec) +
+         (double) (now.tv_nsec - start->tv_nsec) / 1000000000;
+}
+
+// keep 'depth' elements in the queue and cycle them: take one, put it back
+// this is what the scheduler does on every preemption
+void bench_cycle(int depth) {
+  struct timespec start;
+  long sum = 0;
+  Fifo f = fifo_create();
+
+  for(int i=0; i < depth; i++) {
+    fifo_put(&f, i);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(int i=0; i < N_OPS; i++) {
+    int x = fifo_take(&f);
+    sum += x;
+    fifo_put(&f, x);
+  }
+  double secs = elapsed(&start);
+
+  printf("cycle depth %6d: %8.2f Mops/s (checksum %ld)\n",
+         depth, 2*N_OPS / secs / 1000000, sum);
+  fifo_free(&f);
+}
+
+// fill the queue with 'depth' elements and then empty it, many times
+void bench_burst(int depth) {
+  struct timespec start;
+  long sum = 0;
+  Fifo f = fifo_create();
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(int n=0; n < N_OPS/depth; n++) {
+    for(int i=0; i < depth; i++) {
+      fifo_put(&f, i);
+    }
+    for(int i=0; i < depth; i++) {
+      sum += fifo_take(&f);
+    }
+  }
+  double secs = elapsed(&start);
+
+  printf("burst depth %6d: %8.2f Mops/s (checksum %ld)\n",
+         depth, 2*(N_OPS/depth)*depth / secs / 1000000, sum);
+  fifo_free(&f);
+}
+
+int main() {
+#ifdef FIFO_LIST
+  printf("fifo version: linked list\n");
+#else
+  printf("fifo version: ring buffer\n");
+#endif
+
+  bench_cycle(1);
+  bench_cycle(64);
+  bench_cycle(65536);
+  bench_burst(64);
+  bench_burst(65536);
+  return 0;
+}
@@ -0,0 +1,33 @@
+#!/bin/sh
+# ./interp_bench.sh [lines]
+#
+# Measures how many lines per second the interpreter handles, on a job list
+# generated by wlgen with the given number of lines (default 1000000):
+#   check   parse and check every line, without sending it (-n)
+#   stdin   the same, with the list streamed through stdin
+#   pipe    also send the commands to the pipe, drained by cat instead of
+#           the scheduler, so that only the interpreter is measured
+
+LINES=${1:-1000000}
+TMP=$(mktemp -d)
+trap 'rm -rf $TMP; rm -f input.pipe' EXIT
+
+make -s interpreter wlgen workload || exit 1
+
+# wlgen is slower than the interpreter: repeat a block of its lines
+./wlgen -n 1000 -m all -r 1 -k 0.5 > $TMP/block
+awk -v n=$LINES 'NR == FNR { line[FNR] = $0; size = FNR; next }
+                 END { for(i=0; i < n; i++) print line[i % size + 1] }' \
+    $TMP/block /dev/null > $TMP/input
+
+printf "%-8s " check
+./interpreter -q -n $TMP/input | tail -1
+printf "%-8s " stdin
+./interpreter -q -n - < $TMP/input | tail -1
+
+rm -f input.pipe
+mkfifo input.pipe
+cat input.pipe > /dev/null &
+printf "%-8s " pipe
+./interpreter -q $TMP/input | tail -1
+wait
@@ -1,5 +1,26 @@
 /*
-  gcc interpreter.c -o interpreter; ./interpreter
+  gcc interpreter.c protocol.c -o interpreter
+  ./interpreter [-s] [-q] [-n] <input-file | ->
+
+  Each line of the input file is a command for the scheduler:
+    exec <program> [arguments] [w<weight>] [x<copies>]
+  With x<copies>, that many processes of the command are created, each
+  one a separate job. With w<weight>, they get that weight instead of 100
+  (see protocol.h).
+
+  The input is streamed: a regular file is mapped in memory and its lines
+  are parsed in place, and "-" (stdin) or a pipe is read in chunks as it
+  arrives, so a generator can feed the interpreter directly. Commands are
+  sent in batches as soon as a batch is full. Whether a program exists is
+  only asked once per distinct path. At the end it prints how many lines
+  per second it handled.
+
+  -s: send the commands to the socket of the scheduler instead of the
+      pipe, and print the ids of the jobs it created for each line. Many
+      interpreters can use the socket at the same time.
+  -q: only print the lines that are skipped, and the summary
+  -n: check the commands but do not send them (to measure the
+      interpreter alone)
 */
 
 #include <stdio.h>
@@ -7,58 +28,327 @@
 #include <unistd.h>
 #include <string.h>
 #include <fcntl.h>
+#include <time.h>         // clock_gettime
 #include <sys/stat.h>
+#include <sys/mman.h>     // mmap, madvise
+#include <sys/socket.h>   // socket, connect
+#include <sys/un.h>       // sockaddr_un
+
+#include "protocol.h"
 
-#define PIPE_INPUT "./input.pipe"   // named pipe for creating new processes
 #define BUF_SIZE 255                // max size of string buffers
+#define BATCH_CMDS (MSG_MAX / (sizeof(FrameLen)+1) + 1) // max commands in a batch
+#define INPUT_CHUNK 65536           // bytes read at a time from a stream
+#define ACCESS_CACHE 1024           // slots of the cache of access()
+#define ACCESS_PROBES 16            // slots looked at before calling access()
+
+// the input file, as a sequence of lines
+typedef struct {
+  int fd;
+  char *data;           // the whole file if mapped, else the last chunks read
+  size_t len;           // bytes in data
+  size_t pos;           // start of the next line in data
+  int mapped;
+  int eof;              // a stream ended
+} Input;
+
+// result of access(path, F_OK) for a path
+typedef struct {
+  char *path;           // NULL if the slot is free
+  int exists;
+} AccessEntry;
+
+int use_socket = 0, quiet = 0, dry_run = 0;
+AccessEntry access_cache[ACCESS_CACHE];
+
+// line of each command of the batch being filled, and of the batch that
+// was sent and whose replies were not read yet (only with -s)
+int lines[BATCH_CMDS], sent_lines[BATCH_CMDS];
+int n_sent = 0;
+
+// open path, or stdin for "-"
+// returns -1 if it cannot be read
+int input_open(Input *in, char *path) {
+  struct stat st;
+
+  in->fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+  in->pos = in->len = 0;
+  in->mapped = in->eof = 0;
+  if(in->fd < 0 || fstat(in->fd, &st) < 0) {
+    return -1;
+  }
+  if(S_ISREG(st.st_mode) && st.st_size > 0) {
+    in->data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, in->fd, 0);
+    if(in->data != MAP_FAILED) {
+      madvise(in->data, st.st_size, MADV_SEQUENTIAL);
+      in->len = st.st_size;
+      in->mapped = in->eof = 1;
+      return 0;
+    }
+  }
+  in->data = malloc(INPUT_CHUNK);
+  return 0;
+}
+
+// the next line, without its '\n', and its length in len
+// it is not '\0' terminated, and it is only valid until the next call
+// returns NULL at the end of the input
+char *input_line(Input *in, int *len) {
+  while(1) {
+    char *start = &in->data[in->pos];
+    size_t avail = in->len - in->pos;
+    char *end = memchr(start, '\n', avail);
+    if(end != NULL) {
+      *len = end - start;
+      in->pos += *len + 1;
+      return start;
+    }
+    if(in->eof || avail == INPUT_CHUNK) {
+      // the last line has no '\n', or a line does not fit in a chunk
+      if(avail == 0) {
+        return NULL;
+      }
+      *len = avail;
+      in->pos = in->len;
+      return start;
+    }
 
-int str_starts_with(const char *a, const char *b) {
-   return (strncmp(a, b, strlen(b)) == 0) ? 1 : 0;
+    // keep the incomplete line and read more after it
+    memmove(in->data, start, avail);
+    in->len = avail;
+    in->pos = 0;
+    ssize_t n = read(in->fd, &in->data[in->len], INPUT_CHUNK - in->len);
+    if(n <= 0) {
+      in->eof = 1;
+    } else {
+      in->len += n;
+    }
+  }
+}
+
+void input_close(Input *in) {
+  if(in->mapped) {
+    munmap(in->data, in->len);
+  } else {
+    free(in->data);
+  }
+  if(in->fd != STDIN_FILENO) {
+    close(in->fd);
+  }
+}
+
+// access(path, F_OK) == 0, but asking the file system once per distinct
+// path, as long as they fit in access_cache
+int program_exists(char *path) {
+  unsigned int h = 2166136261u;   // FNV-1a
+  for(char *c = path; *c != '\0'; c++) {
+    h = (h ^ (unsigned char) *c) * 16777619u;
+  }
+  for(int i=0; i < ACCESS_PROBES; i++) {
+    AccessEntry *e = &access_cache[(h + i) % ACCESS_CACHE];
+    if(e->path == NULL) {
+      e->path = strdup(path);
+      e->exists = access(path, F_OK) == 0;
+      return e->exists;
+    }
+    if(strcmp(e->path, path) == 0) {
+      return e->exists;
+    }
+  }
+  return access(path, F_OK) == 0;
+}
+
+// connect to the socket of the scheduler
+// returns -1 if it is not running
+int connect_socket() {
+  struct sockaddr_un addr;
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if(fd < 0) {
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, SOCKET_INPUT, sizeof(addr.sun_path)-1);
+  if(connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// read exactly size bytes
+// returns -1 if the scheduler closed the connection first
+int read_all(int fd, void *buf, int size) {
+  int done = 0;
+  while(done < size) {
+    int n = read(fd, (char *) buf + done, size - done);
+    if(n <= 0) {
+      return -1;
+    }
+    done += n;
+  }
+  return 0;
+}
+
+// print the reply of the scheduler to the command of a line
+void print_reply(int line, Reply *r) {
+  if(r->status == REPLY_INVALID) {
+    printf("line %d: REJECTED by the scheduler\n", line);
+  } else if(r->copies == 0) {
+    printf("line %d: FAILED -> no job was created\n", line);
+  } else if(r->status == REPLY_FAILED) {
+    printf("line %d: FAILED -> only jobs %d to %d were created\n",
+           line, r->job, r->job + r->copies - 1);
+  } else if(r->copies == 1) {
+    printf("line %d: job %d\n", line, r->job);
+  } else {
+    printf("line %d: jobs %d to %d\n", line, r->job, r->job + r->copies - 1);
+  }
+}
+
+// read the replies to the batch sent before, and print them
+void read_replies(int fd) {
+  Reply replies[BATCH_CMDS];
+
+  if(n_sent == 0) {
+    return;
+  }
+  if(read_all(fd, replies, n_sent * sizeof(Reply)) < 0) {
+    printf("The scheduler closed the connection\n");
+    exit(1);
+  }
+  for(int i=0; i < n_sent && !quiet; i++) {
+    print_reply(sent_lines[i], &replies[i]);
+  }
+  n_sent = 0;
+}
+
+// send the batch of n commands
+// with the socket, the replies to this batch are read after sending the
+// next one, so that the scheduler works on a batch while we parse the next
+void send_batch(Batch *batch, int fd, int n) {
+  if(dry_run) {
+    batch->len = 0;
+    return;
+  }
+  batch_flush(batch, fd);
+  if(!quiet) {
+    printf("wrote %d commands to the %s\n", n, use_socket ? "socket" : "pipe");
+  }
+  if(use_socket) {
+    read_replies(fd);
+    memcpy(sent_lines, lines, n * sizeof(int));
+    n_sent = n;
+  }
 }
 
 int main(int argc, char *argv[]) {
-  int pipe_fd;
-  char program_name[BUF_SIZE];
-  char line_buffer[BUF_SIZE];
-  FILE* input_fp;
+  int fd = -1, opt, copies, weight, len, line = 0, n_batched = 0;
+  long n_sent_total = 0;
+  char command[BUF_SIZE];
+  char *args[CMD_MAX_ARGS+1];
+  char *text;
+  Batch batch = batch_create();
+  Input input;
+  struct timespec start, end;
 
-  if(argc<2) {
-    printf("Usage: %s <input-file>\n", argv[0]);
+  while((opt = getopt(argc, argv, "sqn")) != -1) {
+    if(opt == 's') {
+      use_socket = 1;
+    } else if(opt == 'q') {
+      quiet = 1;
+    } else if(opt == 'n') {
+      dry_run = 1;
+    } else {
+      printf("Usage: %s [-s] [-q] [-n] <input-file | ->\n", argv[0]);
+      exit(1);
+    }
+  }
+  if(optind != argc-1) {
+    printf("Usage: %s [-s] [-q] [-n] <input-file | ->\n", argv[0]);
+    exit(1);
+  }
+  if(input_open(&input, argv[optind]) < 0) {
+    printf("Cannot open %s\n", argv[optind]);
     exit(1);
   }
 
-  // create named pipe (FIFO)
-  mkfifo(PIPE_INPUT, 0666);
+  if(dry_run) {
+    // nothing is sent
+  } else if(use_socket) {
+    if((fd = connect_socket()) < 0) {
+      printf("Cannot connect to %s: is the scheduler running?\n", SOCKET_INPUT);
+      exit(1);
+    }
+  } else {
+    // create named pipe (FIFO) and keep it open until the end
+    mkfifo(PIPE_INPUT, 0666);
+    fd = open(PIPE_INPUT, O_WRONLY);
+  }
 
   // handle input file line by line
-  input_fp = fopen(argv[1], "r");
-  while(fgets(line_buffer, BUF_SIZE, input_fp)) {
-    // we don't need the \n in the end
-    strtok(line_buffer, "\n");
-    printf("read: '%s' from the file\n", line_buffer);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while((text = input_line(&input, &len)) != NULL) {
+    line++;
+    if(!quiet) {
+      printf("read: '%.*s' from the file\n", len, text);
+    }
 
     // validate line syntax
-    if(!str_starts_with(line_buffer, "exec ")) {
-      printf("SKIPPED line '%s' -> Lines must start with 'exec '.\n", line_buffer);
+    if(len < 5 || memcmp(text, "exec ", 5) != 0) {
+      printf("SKIPPED line '%.*s' -> Lines must start with 'exec '.\n", len, text);
+      continue;
+    }
+    if(len < 6) {
+      printf("SKIPPED line '%.*s' -> Program name is empty.\n", len, text);
       continue;
     }
-    if(strlen(line_buffer) < 6) {
-      printf("SKIPPED line '%s' -> Program name is empty.\n", line_buffer);
+    // the command is sent as it is, but it must be valid
+    // command_parse splits it in place, so it works on a copy
+    char *cmd = &text[5];
+    int cmd_len = len - 5;
+    if(cmd_len >= BUF_SIZE) {
+      printf("SKIPPED line '%.40s...' -> Longer than %d characters.\n", text, BUF_SIZE-1+5);
       continue;
     }
-    strcpy(program_name, &line_buffer[5]);
-    if(access(program_name, F_OK) == -1) {
-      printf("SKIPPED line '%s' -> File '%s' does not exist.\n", line_buffer, program_name);
+    memcpy(command, cmd, cmd_len);
+    command[cmd_len] = '\0';
+    if(command_parse(command, args, &copies, &weight) < 0) {
+      printf("SKIPPED line '%.*s' -> Expected: exec <program> [arguments] [w<weight>] [x<copies>], "
+             "with at most %d words, %d copies and a weight of %d.\n",
+             len, text, CMD_MAX_ARGS, CMD_MAX_COPIES, CMD_MAX_WEIGHT);
       continue;
     }
+    if(!program_exists(args[0])) {
+      printf("SKIPPED line '%.*s' -> File '%s' does not exist.\n", len, text, args[0]);
+      continue;
+    }
+
+    // send valid commands to scheduler in batches
+    if(!batch_add(&batch, cmd, cmd_len)) {
+      send_batch(&batch, fd, n_batched);
+      n_batched = 0;
+      batch_add(&batch, cmd, cmd_len);
+    }
+    lines[n_batched++] = line;
+    n_sent_total++;
+  }
 
-    // send each valid program to scheduler
-    pipe_fd = open(PIPE_INPUT, O_WRONLY);
-    write(pipe_fd, program_name, strlen(program_name)+1);
-    close(pipe_fd);
-    printf("wrote '%s' to the pipe\n", program_name);
+  if(n_batched > 0) {
+    send_batch(&batch, fd, n_batched);
+  }
+  if(use_socket && !dry_run) {
+    read_replies(fd);
   }
+  clock_gettime(CLOCK_MONOTONIC, &end);
 
-  fclose(input_fp);
+  double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf("%d lines, %ld commands %s in %.3f s (%.0f lines/s)\n", line, n_sent_total,
+         dry_run ? "checked" : "sent", secs, secs > 0 ? line / secs : 0);
+
+  if(fd >= 0) {
+    close(fd);
+  }
+  input_close(&input);
   return 0;
 }
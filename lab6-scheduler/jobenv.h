@@ -0,0 +1,16 @@
+/*
+  What the scheduler and the programs it runs agree on: the environment
+  it gives them, and how they report their IO (see preempt.h). Programs
+  written for this scheduler, like workload.c and noop.c, only need this
+  header.
+*/
+
+#include <signal.h>       // SIGRTMIN
+
+#define UT_ENV "SCHED_UT_US"          // the UT of the scheduler, in microsseconds
+#define DEFAULT_UT 2000000            // UT used if UT_ENV is not set, in microsseconds
+#define PREEMPT_ENV "SCHED_PREEMPT"   // how the scheduler stops them: signal, stop or freezer
+
+#define SIG_IO SIGRTMIN     // process -> scheduler, sent with sigqueue
+#define IO_START 1          // value of SIG_IO: the process starts an IO
+#define IO_END 2            // value of SIG_IO: the process ended its IO
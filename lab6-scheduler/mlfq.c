@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include "mlfq.h"
+#include "policy.h"
+
+int ut = DEFAULT_UT;
+int boost_period = -1;
+
+void mlfq_init_ut() {
+  char *env = getenv(UT_ENV);
+  if(env != NULL && atoi(env) > 0) {
+    ut = atoi(env);
+  }
+}
+
+int mlfq_default_boost(int n_levels, int *quanta) {
+  int sum = 0;
+  for(int i=0; i < n_levels; i++) {
+    sum += quanta[i];
+  }
+  return BOOST_ROUNDS * sum;
+}
+
+int mlfq_quantum(ReadyQueue *rq, int level) {
+  return ut * rq->quantum[level];
+}
+
+int mlfq_after_io(ReadyQueue *rq, int level, double runtime) {
+  // we only increase priority if the process left at least half UT of quantum unused
+  // otherwise, we consider that it used "exactly" the whole quantum, without blowing it
+  if(runtime < mlfq_quantum(rq, level) - ut / 2 && level > 0) {
+    return level-1;
+  }
+  return level;
+}
+
+int mlfq_after_quantum(ReadyQueue *rq, int level) {
+  // reduce priority, down to the lowest level
+  if(level < rq->n_levels-1) {
+    return level+1;
+  }
+  return level;
+}
+
+int mlfq_join(ReadyQueue *rq, int level, unsigned int *epoch) {
+  // it was running or doing IO during a boost
+  if(*epoch != rq->epoch) {
+    *epoch = rq->epoch;
+    return 0;
+  }
+  return level;
+}
+
+
+
+/***** policy *****/
+
+typedef struct {
+  ReadyQueue rq;
+  EntityOf entity;
+} MlfqQueue;
+
+static void *create(int n_levels, int *quanta, EntityOf entity) {
+  MlfqQueue *q = malloc(sizeof(MlfqQueue));
+  q->rq = rq_create(n_levels, quanta);
+  q->entity = entity;
+  return q;
+}
+
+static int levels(void *q) {
+  return ((MlfqQueue *) q)->rq.n_levels;
+}
+
+// put it in the queue of its level, or in the highest one if there was a
+// boost since its level was set
+static void join(MlfqQueue *q, int fid) {
+  SchedEntity *se = q->entity(fid);
+  se->priority = mlfq_join(&q->rq, se->priority, &se->epoch);
+  rq_put(&q->rq, se->priority, fid);
+}
+
+static void admit(void *q, int fid) {
+  SchedEntity *se = ((MlfqQueue *) q)->entity(fid);
+  se->priority = 0;
+  se->epoch = ((MlfqQueue *) q)->rq.epoch;
+  join(q, fid);
+}
+
+static int pick_next(void *q) {
+  MlfqQueue *mq = q;
+  int level;
+  int fid = rq_take(&mq->rq, &level);
+  if(fid >= 0) {
+    SchedEntity *se = mq->entity(fid);
+    se->priority = level;
+    se->epoch = mq->rq.epoch;
+  }
+  return fid;
+}
+
+static int quantum_for(void *q, int fid) {
+  MlfqQueue *mq = q;
+  return mlfq_quantum(&mq->rq, mq->entity(fid)->priority);
+}
+
+static void on_preempt(void *q, int fid, double runtime) {
+  MlfqQueue *mq = q;
+  SchedEntity *se = mq->entity(fid);
+  se->priority = mlfq_after_quantum(&mq->rq, se->priority);
+  join(mq, fid);
+}
+
+static void on_block(void *q, int fid, double runtime) {
+  MlfqQueue *mq = q;
+  SchedEntity *se = mq->entity(fid);
+  // it stays out of the queues until its IO ends
+  se->priority = mlfq_after_io(&mq->rq, se->priority, runtime);
+}
+
+static void on_wake(void *q, int fid) {
+  join(q, fid);
+}
+
+static void on_end(void *q, int fid, int queued) {
+  MlfqQueue *mq = q;
+  if(queued) {
+    rq_remove(&mq->rq, mq->entity(fid)->priority, fid);
+  }
+}
+
+static int steal(void *from, void *to) {
+  int level;
+  int fid = rq_steal(&((MlfqQueue *) from)->rq, &level);
+  if(fid >= 0) {
+    SchedEntity *se = ((MlfqQueue *) to)->entity(fid);
+    se->priority = level;
+    se->epoch = ((MlfqQueue *) to)->rq.epoch;
+  }
+  return fid;
+}
+
+static void restore(void *q, int fid, int ready) {
+  MlfqQueue *mq = q;
+  SchedEntity *se = mq->entity(fid);
+  // boosts of the earlier run are forgotten, and it may have had more levels
+  se->epoch = mq->rq.epoch;
+  if(se->priority >= mq->rq.n_levels) {
+    se->priority = mq->rq.n_levels - 1;
+  }
+  if(ready) {
+    rq_put(&mq->rq, se->priority, fid);
+  }
+}
+
+static void boost(void *q) {
+  rq_boost(&((MlfqQueue *) q)->rq);
+}
+
+static void print(void *q) {
+  rq_print(&((MlfqQueue *) q)->rq);
+}
+
+static void destroy(void *q) {
+  rq_free(&((MlfqQueue *) q)->rq);
+  free(q);
+}
+
+Policy mlfq_policy = {
+  "mlfq", create, levels, admit, pick_next, quantum_for,
+  on_preempt, on_block, on_wake, on_end, steal, restore, boost, print, destroy
+};
@@ -0,0 +1,43 @@
+/*
+  Rules of the multilevel feedback queue policy, and mlfq_policy (see
+  policy.h), which applies them to a ReadyQueue.
+*/
+
+#include "readyq.h"
+#include "jobenv.h"       // UT_ENV, DEFAULT_UT
+
+#define BOOST_ROUNDS 3        // default period of the priority boost, in
+                              // rounds of the quanta of all levels
+
+// the time unit, in microsseconds
+// the scheduler exports it in UT_ENV, so that its children use the same one
+extern int ut;
+
+// every boost_period UT all processes go back to the highest priority
+// level, so that a stream of short jobs cannot starve the long ones
+// 0 disables it, and it is -1 until it is set by -a or by mlfq_default_boost
+extern int boost_period;
+
+// default boost_period for these quanta: BOOST_ROUNDS times their sum
+// a starved process gets one quantum of the highest level per boost, so the
+// period must stay short compared with the quanta, whatever they are
+int mlfq_default_boost(int n_levels, int *quanta);
+
+// set ut from UT_ENV, if it is set
+void mlfq_init_ut();
+
+// quantum of a process at this level of rq, in microsseconds
+int mlfq_quantum(ReadyQueue *rq, int level);
+
+// a process at this level started an IO operation after running for
+// runtime microsseconds: returns its new level
+int mlfq_after_io(ReadyQueue *rq, int level, double runtime);
+
+// a process at this level achieved the quantum: returns its new level
+int mlfq_after_quantum(ReadyQueue *rq, int level);
+
+// a process that was at this level joins a queue of rq again, after it
+// arrived, ran or did IO: returns its level, which is the highest one if
+// rq was boosted since its level was set
+// epoch is the epoch of rq when its level was set, and it is updated
+int mlfq_join(ReadyQueue *rq, int level, unsigned int *epoch);
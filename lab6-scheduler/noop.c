@@ -0,0 +1,34 @@
+/*
+  gcc noop.c -o noop
+
+  noop does nothing: it waits to be scheduled once and ends. It is the
+  cheapest job there is, for measuring the scheduler itself (see
+  admit_bench.c).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "jobenv.h"       // PREEMPT_ENV
+
+void sigusr2_handler() {
+}
+
+int main() {
+  sigset_t mask;
+
+  // if the scheduler stops us itself, we only run when it resumes us
+  if(getenv(PREEMPT_ENV) != NULL && strcmp(getenv(PREEMPT_ENV), "signal") != 0) {
+    return 0;
+  }
+
+  // the scheduler created us with SIGUSR2 blocked: wait for it
+  // if our quantum ends before we do, we just end anyway
+  signal(SIGUSR1, SIG_IGN);
+  signal(SIGUSR2, sigusr2_handler);
+  sigprocmask(SIG_BLOCK, NULL, &mask);
+  sigdelset(&mask, SIGUSR2);
+  sigsuspend(&mask);
+  return 0;
+}
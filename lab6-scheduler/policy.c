@@ -0,0 +1,16 @@
+#include <string.h>
+#include "policy.h"
+
+Policy *policy = &mlfq_policy;
+
+static Policy *policies[] = {&mlfq_policy, &stride_policy, &vruntime_policy};
+
+int policy_set(char *name) {
+  for(int i=0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+    if(strcmp(name, policies[i]->name) == 0) {
+      policy = policies[i];
+      return 0;
+    }
+  }
+  return -1;
+}
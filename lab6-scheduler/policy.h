@@ -0,0 +1,102 @@
+/*
+  Scheduling policies: which ready process runs next, and for how long.
+
+  The dispatcher of the scheduler and the simulation mode only talk to a
+  policy through the functions of Policy, and each worker has its own
+  ready queue of the policy. The policies are:
+
+  mlfq: the multilevel feedback queue of mlfq.c. A process goes down one
+    level when it uses its whole quantum, and up one when it starts an IO
+    early. Levels are served in order, and a boost brings everyone back
+    to the top (see readyq.h).
+  stride: every process gets a share of the CPU proportional to its
+    weight. Each one has a pass, that grows with the CPU it used divided
+    by its weight, and the lowest pass runs next
+    for a fixed quantum (the first of -q). A process that blocks early
+    is only charged for what it used, so interactive processes run soon
+    after they wake up.
+  vruntime: like the CFS of Linux. The lowest virtual runtime (CPU time
+    used, divided by the weight) runs next, for a slice that is its
+    weight's part of VR_LATENCY UT among the ready processes, so that all
+    of them run within VR_LATENCY UT. A process that
+    wakes up gets at most VR_LATENCY/2 UT of credit over the others.
+
+  The weight of a process comes from its command (see protocol.h); mlfq
+  ignores it.
+
+  stride and vruntime keep their ready processes in a tree ordered by pass
+  or virtual runtime (see vtree.h).
+*/
+
+// state of a process that belongs to the policy
+typedef struct {
+  int priority;         // level of the ready queue, 0 is the highest priority
+  unsigned int epoch;   // mlfq: epoch of the ready queue when priority was set
+  double vtime;         // stride: pass, vruntime: virtual runtime (microsseconds)
+  int weight;           // stride, vruntime: share of the CPU, POLICY_WEIGHT by default
+} SchedEntity;
+
+#define POLICY_WEIGHT 1024  // weight of a process submitted without w<weight>
+
+// the SchedEntity of a process, given its fid
+typedef SchedEntity *(*EntityOf)(int fid);
+
+typedef struct {
+  char *name;
+
+  // ready queue of one worker: quanta[i] is the quantum of level i, in UT
+  void *(*create)(int n_levels, int *quanta, EntityOf entity);
+
+  // number of levels of priority, for the stats
+  int (*levels)(void *q);
+
+  // a new process joins the queue, with its weight already set
+  void (*admit)(void *q, int fid);
+
+  // remove and return the process that runs next, or -1 if there is none
+  int (*pick_next)(void *q);
+
+  // how long the process picked last may run, in microsseconds
+  int (*quantum_for)(void *q, int fid);
+
+  // it ran for runtime microsseconds and used its whole quantum: it joins
+  // the queue again
+  void (*on_preempt)(void *q, int fid, double runtime);
+
+  // it ran for runtime microsseconds and started an IO: it is not ready
+  void (*on_block)(void *q, int fid, double runtime);
+
+  // it ended its IO: it joins the queue again
+  void (*on_wake)(void *q, int fid);
+
+  // it ended: queued says if it was in the queue, and then it leaves it
+  void (*on_exit)(void *q, int fid, int queued);
+
+  // remove a process from the queue 'from' that will run from 'to'
+  // returns its fid, or -1 if there is none
+  int (*steal)(void *from, void *to);
+
+  // a process of an earlier run of the scheduler comes back, with its
+  // SchedEntity of then (see scheduler.c, -r): if ready, it joins the queue,
+  // otherwise it is doing IO. They come back in the order they joined
+  // their queues
+  void (*restore)(void *q, int fid, int ready);
+
+  // called every boost_period UT (see mlfq.h), or NULL
+  void (*boost)(void *q);
+
+  void (*print)(void *q);
+
+  // free a queue of create
+  void (*destroy)(void *q);
+} Policy;
+
+extern Policy *policy;    // mlfq by default
+
+extern Policy mlfq_policy;
+extern Policy stride_policy;
+extern Policy vruntime_policy;
+
+// set policy from its name
+// returns -1 if there is no such policy
+int policy_set(char *name);
@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>       // realloc
+#include <stdint.h>       // uint64_t
+#include <poll.h>
+#include <sched.h>        // sched_yield
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/stat.h>     // mkdir
+#include <sys/wait.h>     // waitid
+#include "preempt.h"
+#include "stats.h"
+
+// a process that preempt_stop asked to stop, which did not yet
+typedef struct {
+  int pid;
+  double start;     // when it was asked
+  int events_fd;    // its cgroup.events, in preempt_fd (PREEMPT_FREEZER)
+} Stopping;
+
+int preempt_mode = PREEMPT_SIGNAL;
+char *preempt_cgroup = DEFAULT_CGROUP;
+int preempt_fd = -1;
+
+static Stopping *stopping;
+static int n_stopping, stopping_size;
+
+// in preempt_fd, expires at the deadline of the first stop that may time
+// out, so that a timeout is seen even if nothing else happens
+static int timeout_fd = -1;
+static double timeout_at;     // when timeout_fd expires, 0 if disarmed
+
+static char *mode_names[] = {"signal", "stop", "freezer"};
+
+int preempt_set_mode(char *name) {
+  for(int i=0; i < 3; i++) {
+    if(strcmp(name, mode_names[i]) == 0) {
+      preempt_mode = i;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+char *preempt_mode_name() {
+  return mode_names[preempt_mode];
+}
+
+// write a short string to a file of the cgroup of pid, or of preempt_cgroup
+// if pid is 0
+static int cgroup_write(int pid, char *file, char *value) {
+  char path[512];
+  if(pid == 0) {
+    snprintf(path, sizeof(path), "%s/%s", preempt_cgroup, file);
+  } else {
+    snprintf(path, sizeof(path), "%s/job%d/%s", preempt_cgroup, pid, file);
+  }
+  int fd = open(path, O_WRONLY);
+  if(fd < 0) {
+    return -1;
+  }
+  int n = write(fd, value, strlen(value));
+  close(fd);
+  return n < 0 ? -1 : 0;
+}
+
+// open the cgroup.events file of pid, which is readable with POLLPRI when
+// it changes
+static int cgroup_events(int pid) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/job%d/cgroup.events", preempt_cgroup, pid);
+  return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+// is the cgroup frozen? (its cgroup.events has a "frozen 1" line)
+// reading it also clears its POLLPRI
+static int cgroup_frozen(int events_fd) {
+  char buf[256];
+  int n = pread(events_fd, buf, sizeof(buf)-1, 0);
+  if(n < 0) {
+    return -1;
+  }
+  buf[n] = '\0';
+  return strstr(buf, "frozen 1") != NULL;
+}
+
+// is pid stopped by a signal? (without consuming its wait status)
+static int is_stopped(int pid) {
+  siginfo_t info;
+  info.si_pid = 0;
+  if(waitid(P_PID, pid, &info, WSTOPPED | WNOHANG | WNOWAIT) < 0) {
+    return -1;
+  }
+  return info.si_pid == pid && info.si_code == CLD_STOPPED;
+}
+
+// can we write this file of preempt_cgroup?
+static int cgroup_writable(char *file) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s", preempt_cgroup, file);
+  if(access(path, W_OK) < 0) {
+    printf("[PREEMPT] cannot write %s: %s\n", path, strerror(errno));
+    return 0;
+  }
+  return 1;
+}
+
+// arm timeout_fd to expire at this time (as stats_now), or disarm it if 0
+static void timeout_arm(double at) {
+  if(at == timeout_at) {
+    return;
+  }
+  struct itimerspec its = {{0, 0}, {(time_t) (at / 1000000), (long) ((long long) at % 1000000) * 1000}};
+  timerfd_settime(timeout_fd, TFD_TIMER_ABSTIME, &its, NULL);
+  timeout_at = at;
+}
+
+// preempt_fd, with timeout_fd in it
+static int stop_fds_init() {
+  if((preempt_fd = epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+     (timeout_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+    return -1;
+  }
+  struct epoll_event ev = {EPOLLIN, {.fd = timeout_fd}};
+  return epoll_ctl(preempt_fd, EPOLL_CTL_ADD, timeout_fd, &ev);
+}
+
+int preempt_init() {
+  if(preempt_mode == PREEMPT_SIGNAL) {
+    return 0;
+  }
+  if(preempt_mode == PREEMPT_STOP) {
+    return stop_fds_init();
+  }
+  // the cgroup may exist from a previous run
+  int created = mkdir(preempt_cgroup, 0755) == 0;
+  if(!created && access(preempt_cgroup, W_OK) < 0) {
+    printf("[PREEMPT] cannot create %s: %s\n", preempt_cgroup, strerror(errno));
+    return -1;
+  }
+  // it must be a cgroup v2 where we can freeze and create the cgroups of
+  // the processes, or every admission would fail
+  if(!cgroup_writable("cgroup.freeze") || !cgroup_writable("cgroup.subtree_control")) {
+    if(created) {
+      rmdir(preempt_cgroup);
+    }
+    return -1;
+  }
+  // and the cgroup.events of the processes being frozen
+  return stop_fds_init();
+}
+
+void preempt_child() {
+  if(preempt_mode == PREEMPT_SIGNAL) {
+    // the child must not inherit the signals blocked by the scheduler,
+    // except SIGUSR2, which must wait until the child is ready for it
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR2);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+    return;
+  }
+
+  // stop here, before running the program
+  // in PREEMPT_FREEZER, the parent freezes us and then sends SIGCONT
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigprocmask(SIG_SETMASK, &mask, NULL);
+  raise(SIGSTOP);
+}
+
+int preempt_wait_parked(int pid) {
+  siginfo_t info;
+  char pidstr[32];
+
+  if(preempt_mode == PREEMPT_SIGNAL) {
+    // the process parks itself, and SIGUSR2 waits for it (see workload.c)
+    return 0;
+  }
+
+  // wait for the raise(SIGSTOP) of preempt_child
+  if(waitid(P_PID, pid, &info, WSTOPPED | WEXITED | WNOWAIT) < 0 ||
+     info.si_code != CLD_STOPPED) {
+    return -1;
+  }
+  if(preempt_mode == PREEMPT_STOP) {
+    return 0;
+  }
+
+  // move it to a frozen cgroup of its own, and let it continue there
+  char path[512];
+  snprintf(path, sizeof(path), "%s/job%d", preempt_cgroup, pid);
+  snprintf(pidstr, sizeof(pidstr), "%d", pid);
+  if(mkdir(path, 0755) < 0 || cgroup_write(pid, "cgroup.procs", pidstr) < 0 ||
+     cgroup_write(pid, "cgroup.freeze", "1") < 0) {
+    printf("[PREEMPT] could not create cgroup %s\n", path);
+    return -1;
+  }
+  // wait until it is frozen, as it would run a bit after SIGCONT otherwise
+  struct pollfd events = {cgroup_events(pid), POLLPRI, 0};
+  int frozen;
+  while((frozen = cgroup_frozen(events.fd)) == 0 && poll(&events, 1, PREEMPT_TIMEOUT / 1000) > 0) {
+  }
+  close(events.fd);
+  if(frozen <= 0) {
+    printf("[PREEMPT] could not freeze %d\n", pid);
+    return -1;
+  }
+  kill(pid, SIGCONT);
+  return 0;
+}
+
+// forget the stop of stopping[i]
+static void stop_forget(int i) {
+  if(stopping[i].events_fd >= 0) {
+    close(stopping[i].events_fd);   // which also takes it out of preempt_fd
+  }
+  stopping[i] = stopping[--n_stopping];
+}
+
+// forget the stop of pid, if it is stopping
+static void stop_cancel(int pid) {
+  for(int i=0; i < n_stopping; i++) {
+    if(stopping[i].pid == pid) {
+      stop_forget(i);
+      return;
+    }
+  }
+}
+
+void preempt_resume(int pid) {
+  // if it did not stop yet, it will not now
+  stop_cancel(pid);
+  if(preempt_mode == PREEMPT_SIGNAL) {
+    kill(pid, SIGUSR2);
+  } else if(preempt_mode == PREEMPT_STOP) {
+    kill(pid, SIGCONT);
+  } else {
+    cgroup_write(pid, "cgroup.freeze", "0");
+  }
+}
+
+void preempt_stop(int pid) {
+  if(preempt_mode == PREEMPT_SIGNAL) {
+    kill(pid, SIGUSR1);
+    return;
+  }
+
+  // it only stops when it runs again to see the signal, or when the
+  // freezer gets to it: preempt_check looks at it later
+  stop_cancel(pid);
+  if(n_stopping == stopping_size) {
+    stopping_size = stopping_size == 0 ? 16 : 2*stopping_size;
+    stopping = realloc(stopping, stopping_size * sizeof(Stopping));
+  }
+  Stopping *s = &stopping[n_stopping++];
+  s->pid = pid;
+  s->start = stats_now();
+  s->events_fd = -1;
+  if(preempt_mode == PREEMPT_STOP) {
+    kill(pid, SIGSTOP);
+    // if it shares our CPU, let it get to the signal now, once: this does
+    // not wait for it
+    sched_yield();
+  } else {
+    cgroup_write(pid, "cgroup.freeze", "1");
+    if((s->events_fd = cgroup_events(pid)) >= 0) {
+      struct epoll_event ev = {EPOLLPRI, {.fd = s->events_fd}};
+      epoll_ctl(preempt_fd, EPOLL_CTL_ADD, s->events_fd, &ev);
+    }
+  }
+  preempt_check();
+}
+
+void preempt_check() {
+  uint64_t expirations;
+  read(timeout_fd, &expirations, sizeof(expirations));
+
+  double now = stats_now();
+  double next = 0;    // first deadline of the stops still pending
+  for(int i=0; i < n_stopping; i++) {
+    Stopping *s = &stopping[i];
+    int stopped = preempt_mode == PREEMPT_STOP ? is_stopped(s->pid) :
+                  s->events_fd >= 0 ? cgroup_frozen(s->events_fd) : -1;
+    if(stopped == 0 && now - s->start < PREEMPT_TIMEOUT) {
+      if(next == 0 || s->start + PREEMPT_TIMEOUT < next) {
+        next = s->start + PREEMPT_TIMEOUT;
+      }
+      continue;
+    }
+    if(stopped > 0) {
+      stats_stop(now - s->start);
+    } else if(stopped == 0) {
+      stats_stop_timeout();
+    }
+    // otherwise we cannot know (it is not our child anymore, or has no
+    // cgroup)
+    stop_forget(i--);
+  }
+  timeout_arm(next);
+}
+
+void preempt_release(int pid) {
+  char path[512];
+  stop_cancel(pid);
+  if(preempt_mode == PREEMPT_FREEZER) {
+    snprintf(path, sizeof(path), "%s/job%d", preempt_cgroup, pid);
+    rmdir(path);
+  }
+}
@@ -0,0 +1,69 @@
+/*
+  How the scheduler stops and resumes its processes.
+
+  PREEMPT_SIGNAL: SIGUSR1 stops and SIGUSR2 resumes. The process must
+    cooperate, like workload.c does.
+  PREEMPT_STOP: SIGSTOP and SIGCONT. Works with any program.
+  PREEMPT_FREEZER: each process gets its own cgroup v2, under
+    preempt_cgroup, and cgroup.freeze stops and resumes it. Works with
+    any program, and the process cannot see or block it.
+
+  In all modes the process is created already stopped: it only starts
+  running when it is resumed for the first time.
+
+  Programs written for this scheduler report their IO, in every mode, with
+  SIG_IO, sent with sigqueue and IO_START or IO_END as its value. It is a
+  real-time signal, so the kernel queues every one: IO ends of many
+  processes at once are not merged into one, as SIGUSR2 would be, and the
+  reports of each process arrive in the order it sent them.
+*/
+
+#include "jobenv.h"       // PREEMPT_ENV, SIG_IO, IO_START, IO_END
+
+#define PREEMPT_SIGNAL 0
+#define PREEMPT_STOP 1
+#define PREEMPT_FREEZER 2
+
+#define DEFAULT_CGROUP "/sys/fs/cgroup/scheduler"
+#define PREEMPT_TIMEOUT 100000  // max time for a process to stop, in microsseconds
+
+extern int preempt_mode;
+extern char *preempt_cgroup;          // parent of the cgroups of the processes
+extern int preempt_fd;                // see preempt_check
+
+// set preempt_mode from its name
+// returns -1 if there is no such mode
+int preempt_set_mode(char *name);
+
+// name of preempt_mode
+char *preempt_mode_name();
+
+// prepare the mode, in the scheduler, before creating processes
+// returns -1 on error
+int preempt_init();
+
+// in the child, before execv
+void preempt_child();
+
+// in the parent, after fork: returns when the child is stopped
+// returns -1 if the child ended instead
+int preempt_wait_parked(int pid);
+
+// resume a stopped process
+void preempt_resume(int pid);
+
+// stop a running process
+// it does not wait until the process is really stopped: preempt_check
+// tells when it is (PREEMPT_STOP, PREEMPT_FREEZER)
+void preempt_stop(int pid);
+
+// see which of the processes preempt_stop was asked to stop did, and add
+// how long each one took to the stats. A process that takes more than
+// PREEMPT_TIMEOUT is counted as a timeout, and not looked at any more.
+// Call it when preempt_fd is readable (PREEMPT_STOP and PREEMPT_FREEZER, -1
+// in PREEMPT_SIGNAL), which it also is when a stop times out, and when
+// SIGCHLD arrives (PREEMPT_STOP)
+void preempt_check();
+
+// the process ended: release what preempt_wait_parked created for it
+void preempt_release(int pid);
@@ -0,0 +1,258 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>       // ftruncate, sysconf
+#include <fcntl.h>        // open
+#include <sys/mman.h>     // mmap
+#include <sys/stat.h>     // fstat
+#include "proctable.h"
+
+#define IDX_EMPTY -1        // slot never used
+#define IDX_DELETED -2      // slot used by a removed process
+#define IDX_MIN_SIZE 64     // initial number of slots of an index
+
+/***** indexes *****/
+
+static unsigned int hash_pid(int pid) {
+  return (unsigned int) pid * 2654435761u;
+}
+
+static Index idx_create() {
+  Index idx = {malloc(IDX_MIN_SIZE * sizeof(int)), IDX_MIN_SIZE, 0};
+  assert(idx.slots != NULL);
+  memset(idx.slots, IDX_EMPTY, IDX_MIN_SIZE * sizeof(int));
+  return idx;
+}
+
+static void idx_insert(ProcTable *pt, Index *idx, int fid);
+
+// rebuild the index with twice the live entries, dropping IDX_DELETED
+static void idx_rehash(ProcTable *pt, Index *idx) {
+  int *old = idx->slots;
+  int old_size = idx->size;
+
+  idx->size = 2*old_size;
+  while(idx->size > IDX_MIN_SIZE && idx->size/4 > pt->count) {
+    idx->size /= 2;
+  }
+  idx->slots = malloc(idx->size * sizeof(int));
+  assert(idx->slots != NULL);
+  memset(idx->slots, IDX_EMPTY, idx->size * sizeof(int));
+  idx->filled = 0;
+
+  for(int i=0; i < old_size; i++) {
+    if(old[i] >= 0) {
+      idx_insert(pt, idx, old[i]);
+    }
+  }
+  free(old);
+}
+
+static void idx_insert(ProcTable *pt, Index *idx, int fid) {
+  // keep at most half of the slots filled, so probing stays short
+  if(2*(idx->filled+1) > idx->size) {
+    idx_rehash(pt, idx);
+  }
+
+  unsigned int mask = idx->size - 1;
+  unsigned int i = hash_pid(pt_get(pt, fid)->pid) & mask;
+  while(idx->slots[i] >= 0) {
+    i = (i+1) & mask;
+  }
+  if(idx->slots[i] == IDX_EMPTY) {
+    idx->filled++;
+  }
+  idx->slots[i] = fid;
+}
+
+// returns the slot holding fid
+static int idx_slot(ProcTable *pt, Index *idx, int fid) {
+  unsigned int mask = idx->size - 1;
+  unsigned int i = hash_pid(pt_get(pt, fid)->pid) & mask;
+  while(idx->slots[i] != fid) {
+    assert(idx->slots[i] != IDX_EMPTY);
+    i = (i+1) & mask;
+  }
+  return i;
+}
+
+
+
+/***** process table *****/
+
+// offset of chunk i in the file: the header has the first page, and each
+// chunk starts on a page, as mmap needs
+static off_t chunk_offset(int i) {
+  long page = sysconf(_SC_PAGESIZE);
+  off_t chunk = ((off_t) PT_CHUNK * sizeof(Process) + page - 1) / page * page;
+  return page + i * chunk;
+}
+
+// map chunk i of the file, which must be big enough, or allocate it if the
+// table is in memory
+// returns NULL on error
+static Process *chunk_map(ProcTable *pt, int i) {
+  if(pt->fd < 0) {
+    return calloc(PT_CHUNK, sizeof(Process));
+  }
+  void *chunk = mmap(NULL, PT_CHUNK * sizeof(Process), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, pt->fd, chunk_offset(i));
+  return chunk == MAP_FAILED ? NULL : chunk;
+}
+
+// map the header of the file, which must be big enough
+// returns NULL on error
+static PtHeader *header_map(int fd) {
+  assert(sizeof(PtHeader) <= (size_t) sysconf(_SC_PAGESIZE));
+  void *h = mmap(NULL, sizeof(PtHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  return h == MAP_FAILED ? NULL : h;
+}
+
+ProcTable pt_create(char *path) {
+  ProcTable pt;
+  memset(&pt, 0, sizeof(pt));
+  pt.by_pid = idx_create();
+
+  pt.fd = path == NULL ? -1 : open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if(pt.fd >= 0 && (ftruncate(pt.fd, chunk_offset(0)) < 0 ||
+                    (pt.header = header_map(pt.fd)) == NULL)) {
+    close(pt.fd);
+    pt.fd = -1;
+  }
+  if(pt.fd < 0) {
+    pt.header = calloc(1, sizeof(PtHeader));
+    assert(pt.header != NULL);
+  }
+  memcpy(pt.header->magic, PT_MAGIC, sizeof(pt.header->magic));
+  pt.header->version = PT_VERSION;
+  pt.header->process_size = sizeof(Process);
+  return pt;
+}
+
+int pt_load(ProcTable *pt, char *path) {
+  struct stat st;
+  PtHeader *h = NULL;
+
+  int fd = open(path, O_RDWR | O_CLOEXEC);
+  if(fd < 0) {
+    return -1;
+  }
+  if(fstat(fd, &st) < 0 || st.st_size < chunk_offset(0) || (h = header_map(fd)) == NULL ||
+     memcmp(h->magic, PT_MAGIC, sizeof(h->magic)) != 0 || h->version != PT_VERSION ||
+     h->process_size != sizeof(Process) || h->size < 0 ||
+     h->size > PT_CHUNK * PT_MAX_CHUNKS ||
+     st.st_size < chunk_offset((h->size + PT_CHUNK - 1) / PT_CHUNK)) {
+    if(h != NULL) {
+      munmap(h, sizeof(PtHeader));
+    }
+    close(fd);
+    return -1;
+  }
+
+  memset(pt, 0, sizeof(*pt));
+  pt->fd = fd;
+  pt->header = h;
+  pt->size = h->size;
+  int n_chunks = (pt->size + PT_CHUNK - 1) / PT_CHUNK;
+  for(int i=0; i < n_chunks; i++) {
+    if((pt->chunks[i] = chunk_map(pt, i)) == NULL) {
+      return -1;
+    }
+  }
+
+  // rebuild what is only in memory: the index and the free fids
+  pt->by_pid = idx_create();
+  pt->free_fids = malloc(n_chunks * PT_CHUNK * sizeof(int));
+  assert(n_chunks == 0 || pt->free_fids != NULL);
+  for(int fid = pt->size-1; fid >= 0; fid--) {
+    if(pt_get(pt, fid) == NULL) {
+      pt->free_fids[pt->n_free++] = fid;
+    } else {
+      pt->count++;
+      idx_insert(pt, &pt->by_pid, fid);
+    }
+  }
+  return 0;
+}
+
+Process *pt_get(ProcTable *pt, int fid) {
+  if(fid < 0 || fid >= pt->size) {
+    return NULL;
+  }
+  Process *p = &pt->chunks[fid / PT_CHUNK][fid % PT_CHUNK];
+  return p->used ? p : NULL;
+}
+
+Process *pt_add(ProcTable *pt, int pid, int job, char *prog) {
+  int fid;
+
+  if(pt->n_free > 0) {
+    // reuse the fid of a removed process
+    fid = pt->free_fids[--pt->n_free];
+  } else {
+    // allocate a new fid, and a new chunk if the last one is full
+    fid = pt->size;
+    if(fid % PT_CHUNK == 0) {
+      if(fid / PT_CHUNK == PT_MAX_CHUNKS) {
+        return NULL;
+      }
+      int i = fid / PT_CHUNK;
+      if(pt->fd >= 0 && ftruncate(pt->fd, chunk_offset(i+1)) < 0) {
+        return NULL;
+      }
+      pt->chunks[i] = chunk_map(pt, i);
+      assert(pt->chunks[i] != NULL);
+
+      // there is room for every fid in free_fids, so pt_remove never fails
+      pt->free_fids = realloc(pt->free_fids, (fid + PT_CHUNK) * sizeof(int));
+      assert(pt->free_fids != NULL);
+    }
+    pt->size++;
+    pt->header->size = pt->size;
+  }
+
+  Process *p = &pt->chunks[fid / PT_CHUNK][fid % PT_CHUNK];
+  p->fid = fid;
+  p->pid = pid;
+  p->job = job;
+  memset(&p->se, 0, sizeof(p->se));
+  p->used = 1;
+  p->worker = 0;
+  p->queued = 0;
+  p->blocked = 0;
+  p->running = 0;
+  p->seq = 0;
+  p->admitted_at = 0;
+  p->cpu_seen = 0;
+  strncpy(p->prog, prog, BUF_SIZE-1);
+  p->prog[BUF_SIZE-1] = '\0';
+  pt->count++;
+
+  idx_insert(pt, &pt->by_pid, fid);
+  return p;
+}
+
+void pt_remove(ProcTable *pt, int fid) {
+  Process *p = pt_get(pt, fid);
+  if(p == NULL) {
+    return;
+  }
+
+  pt->by_pid.slots[idx_slot(pt, &pt->by_pid, fid)] = IDX_DELETED;
+
+  p->used = 0;
+  pt->count--;
+  pt->free_fids[pt->n_free++] = fid;
+}
+
+int pt_find_pid(ProcTable *pt, int pid) {
+  unsigned int mask = pt->by_pid.size - 1;
+  for(unsigned int i = hash_pid(pid) & mask;
+      pt->by_pid.slots[i] != IDX_EMPTY; i = (i+1) & mask) {
+    int fid = pt->by_pid.slots[i];
+    if(fid >= 0 && pt_get(pt, fid)->pid == pid) {
+      return fid;
+    }
+  }
+  return -1;
+}
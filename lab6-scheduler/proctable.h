@@ -0,0 +1,95 @@
+/*
+  Table of the processes of the scheduler.
+
+  It can be kept in a file instead of plain memory (see pt_create): the
+  file is mapped, so every change to a process is in it as soon as it is
+  made, without writing anything, and a new run of the scheduler can take
+  the table back with pt_load. The file is a PtHeader, in the first page,
+  followed by the chunks of processes, each one starting on a new page.
+*/
+
+#include <stdint.h>
+#include "stats.h"
+#include "policy.h"
+
+#define BUF_SIZE 255        // max size of string buffers
+#define PT_CHUNK 1024       // number of processes allocated at a time
+#define PT_MAX_CHUNKS 1024  // so at most PT_CHUNK*PT_MAX_CHUNKS processes
+#define PT_MAGIC "SCHSTATE"
+#define PT_VERSION 3
+
+typedef struct {
+  int fid;              // "FIFO id"  = id of this process in this scheduler
+  int pid;              // "unix pid" = id of this process in the OS
+  int job;              // id given to it when it was submitted, never reused
+  int used;             // is this slot of the table in use?
+  int worker;           // worker whose queues this process joins
+  int queued;           // is it in one of the queues of its worker?
+  int pidfd;            // becomes readable when the process ends
+  int blocked;          // did we see it block, and it did not wake up yet?
+  int running;          // is it the running process of its worker?
+  long seq;             // when it last joined a queue: joins are numbered in order
+  double admitted_at;   // when it was admitted, in microsseconds after boot
+  double cpu_seen;      // its CPU time when we last looked, in microsseconds
+  char prog[BUF_SIZE];  // command it runs: path of the program and its arguments
+  SchedEntity se;       // state of the scheduling policy
+  ProcStats stats;      // accounting of this process
+} Process;
+
+// hash index from a pid to a fid, with open addressing
+// the pids are not stored here: they are read from the process table
+typedef struct {
+  int *slots;   // fid, or IDX_EMPTY, or IDX_DELETED
+  int size;     // number of slots, always a power of 2
+  int filled;   // number of slots that are not IDX_EMPTY
+} Index;
+
+// first page of the file of a table, with what else must survive a restart
+typedef struct {
+  char magic[8];          // PT_MAGIC, without the '\0'
+  uint32_t version;       // PT_VERSION
+  uint32_t process_size;  // sizeof(Process)
+  int32_t size;           // same as in ProcTable
+  int32_t next_job;       // id of the next job to be submitted
+  int64_t next_seq;       // seq of the next process to join a queue
+  char tag[32];           // what the processes were scheduled with
+  Stats stats;            // global counters, see stats_init
+} PtHeader;
+
+// table of processes, indexed by fid
+// processes are allocated in chunks that never move, so a Process*
+// stays valid while the table grows
+// fids of removed processes are reused by the next pt_add
+typedef struct {
+  Process *chunks[PT_MAX_CHUNKS];
+  int size;         // fids in [0, size) have been allocated at least once
+  int count;        // number of processes in use
+  int *free_fids;   // stack of fids available for reuse
+  int n_free;
+  Index by_pid;
+  PtHeader *header; // in the file, or in memory
+  int fd;           // of the file, or -1
+} ProcTable;
+
+// returns an empty process table
+// if path is not NULL, it is kept in that file, which is replaced; if the
+// file cannot be created, it is kept in memory
+ProcTable pt_create(char *path);
+
+// take back the table kept in path by an earlier run, with all its
+// processes: it goes on being kept there
+// returns -1 if path does not have a table of this version of the scheduler
+int pt_load(ProcTable *pt, char *path);
+
+// returns the process with this fid, or NULL if it is not in use
+Process *pt_get(ProcTable *pt, int fid);
+
+// add a new process with priority 0 and worker 0 and returns it
+// returns NULL if the table is full
+Process *pt_add(ProcTable *pt, int pid, int job, char *prog);
+
+// remove the process from the table, its fid may be reused
+void pt_remove(ProcTable *pt, int fid);
+
+// returns the fid of the process with this pid, or -1
+int pt_find_pid(ProcTable *pt, int pid);
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>         // clock_gettime
+#include "procwatch.h"
+
+// read a small /proc file of pid into buf
+// returns the number of bytes read, or -1
+static int read_proc(int pid, char *file, char *buf, int size) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/%s", pid, file);
+  int fd = open(path, O_RDONLY);
+  if(fd < 0) {
+    return -1;
+  }
+  int n = read(fd, buf, size-1);
+  close(fd);
+  if(n <= 0) {
+    return -1;
+  }
+  buf[n] = '\0';
+  return n;
+}
+
+int procwatch_sample(int pid, ProcSample *s) {
+  char buf[512];
+  unsigned long long cpu_ns;
+
+  // "pid (comm) state ...": comm may have spaces and parentheses, so the
+  // state comes after the last ')'
+  if(read_proc(pid, "stat", buf, sizeof(buf)) < 0) {
+    return -1;
+  }
+  char *end = strrchr(buf, ')');
+  if(end == NULL || end[1] == '\0') {
+    return -1;
+  }
+  s->state = end[2];
+
+  // "time on cpu (ns), time waiting for the cpu (ns), number of timeslices"
+  if(read_proc(pid, "schedstat", buf, sizeof(buf)) < 0 ||
+     sscanf(buf, "%llu", &cpu_ns) != 1) {
+    return -1;
+  }
+  s->cpu = cpu_ns / 1000.0;
+  return 0;
+}
+
+int procwatch_sleeping(ProcSample *s) {
+  return s->state == 'S' || s->state == 'D';
+}
+
+double procwatch_boottime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_BOOTTIME, &ts);
+  return (double) ts.tv_sec * 1000000 + (double) ts.tv_nsec / 1000;
+}
+
+double procwatch_start(int pid) {
+  char buf[512];
+  unsigned long long ticks;
+
+  if(read_proc(pid, "stat", buf, sizeof(buf)) < 0) {
+    return -1;
+  }
+  // the start time is the 22nd field, and the state (3rd) follows ')'
+  char *end = strrchr(buf, ')');
+  if(end == NULL || sscanf(end + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u"
+                           " %*u %*u %*d %*d %*d %*d %*d %*d %llu", &ticks) != 1) {
+    return -1;
+  }
+  return (double) ticks * 1000000 / sysconf(_SC_CLK_TCK);
+}
@@ -0,0 +1,26 @@
+/*
+  What the kernel says about a process, read from /proc. The scheduler
+  uses it to see that a process blocked (on disk, network, a pipe...)
+  without being told by the process.
+*/
+
+typedef struct {
+  char state;     // R (running), S (sleeping), D (disk sleep), T (stopped)...
+  double cpu;     // CPU time used so far, in microsseconds
+} ProcSample;
+
+// read the state and CPU time of pid from /proc/<pid>/stat and
+// /proc/<pid>/schedstat
+// returns -1 if the process does not exist anymore
+int procwatch_sample(int pid, ProcSample *s);
+
+// is a process in this state waiting for something (not for the CPU)?
+int procwatch_sleeping(ProcSample *s);
+
+// microsseconds since boot, as the start times of procwatch_start
+double procwatch_boottime();
+
+// when pid started, in microsseconds since boot (with the resolution of
+// the clock ticks of /proc, 10ms usually)
+// returns -1 if the process does not exist anymore
+double procwatch_start(int pid);
@@ -0,0 +1,156 @@
+#include <stdlib.h>       // atoi
+#include <string.h>
+#include <unistd.h>
+#include "protocol.h"
+
+Batch batch_create() {
+  Batch b;
+  b.len = 0;
+  return b;
+}
+
+int batch_add(Batch *b, const char *cmd, int len) {
+  FrameLen flen = len;
+  if(b->len + (int) sizeof(flen) + len > MSG_MAX) {
+    return 0;
+  }
+  memcpy(&b->data[b->len], &flen, sizeof(flen));
+  memcpy(&b->data[b->len + sizeof(flen)], cmd, len);
+  b->len += sizeof(flen) + len;
+  return 1;
+}
+
+int batch_flush(Batch *b, int fd) {
+  int done = 0;
+  while(done < b->len) {
+    int n = write(fd, &b->data[done], b->len - done);
+    if(n < 0) {
+      return -1;
+    }
+    done += n;
+  }
+  b->len = 0;
+  return 0;
+}
+
+Reader reader_create() {
+  Reader r;
+  r.start = 0;
+  r.len = 0;
+  return r;
+}
+
+int reader_fill(Reader *r, int fd) {
+  // move the incomplete frame, if any, to the start of the buffer
+  memmove(r->data, &r->data[r->start], r->len - r->start);
+  r->len -= r->start;
+  r->start = 0;
+
+  int n = read(fd, &r->data[r->len], sizeof(r->data) - r->len);
+  if(n > 0) {
+    r->len += n;
+  }
+  return n;
+}
+
+int reader_finish(Reader *r, int fd) {
+  FrameLen flen;
+
+  // make room for the whole frame, as reader_fill
+  memmove(r->data, &r->data[r->start], r->len - r->start);
+  r->len -= r->start;
+  r->start = 0;
+
+  while(r->len > 0) {
+    // first its length, then the rest
+    int need = (int) sizeof(flen) - r->len;
+    if(need <= 0) {
+      memcpy(&flen, r->data, sizeof(flen));
+      if(flen > FRAME_MAX) {
+        return -1;
+      }
+      need = (int) sizeof(flen) + flen - r->len;
+      if(need <= 0) {
+        return 0;
+      }
+    }
+    int n = read(fd, &r->data[r->len], need);
+    if(n <= 0) {
+      return -1;
+    }
+    r->len += n;
+  }
+  return 0;
+}
+
+int reader_next(Reader *r, char *cmd, int cmd_size) {
+  FrameLen flen;
+  int avail = r->len - r->start;
+
+  if(avail < (int) sizeof(flen)) {
+    return -1;
+  }
+  memcpy(&flen, &r->data[r->start], sizeof(flen));
+  if(flen > FRAME_MAX) {
+    return -2;
+  }
+  if(avail < (int) sizeof(flen) + flen) {
+    return -1;
+  }
+
+  int len = flen < cmd_size-1 ? flen : cmd_size-1;
+  memcpy(cmd, &r->data[r->start + sizeof(flen)], len);
+  cmd[len] = '\0';
+  r->start += sizeof(flen) + flen;
+  return len;
+}
+
+int command_split(char *cmd, char *argv[CMD_MAX_ARGS+1]) {
+  int argc = 0;
+  char *save;
+
+  for(char *word = strtok_r(cmd, " ", &save); word != NULL; word = strtok_r(NULL, " ", &save)) {
+    if(argc == CMD_MAX_ARGS) {
+      return -1;
+    }
+    argv[argc++] = word;
+  }
+  argv[argc] = NULL;
+  return argc;
+}
+
+int command_parse(char *cmd, char *argv[CMD_MAX_ARGS+1], int *copies, int *weight) {
+  int argc = command_split(cmd, argv);
+  if(argc < 0) {
+    return -1;
+  }
+
+  // last words like x100 and w200 are the number of copies and the weight,
+  // not arguments
+  *copies = 1;
+  *weight = CMD_WEIGHT;
+  int got_copies = 0, got_weight = 0;
+  while(argc > 1) {
+    char *last = argv[argc-1];
+    if((last[0] != 'x' || got_copies) && (last[0] != 'w' || got_weight)) {
+      break;
+    }
+    if(last[1] == '\0' || strspn(&last[1], "0123456789") != strlen(&last[1])) {
+      break;
+    }
+    argv[--argc] = NULL;
+    int value = strlen(&last[1]) > 6 ? -1 : atoi(&last[1]);
+    if(last[0] == 'x') {
+      got_copies = 1;
+      if((*copies = value) < 1 || *copies > CMD_MAX_COPIES) {
+        return -1;
+      }
+    } else {
+      got_weight = 1;
+      if((*weight = value) < 1 || *weight > CMD_MAX_WEIGHT) {
+        return -1;
+      }
+    }
+  }
+  return argc > 0 ? argc : -1;
+}
@@ -0,0 +1,103 @@
+/*
+  Messages from the interpreter to the scheduler.
+
+  Both ends keep PIPE_INPUT open. Each command is sent as a frame:
+    [length: unsigned short][command: 'length' bytes, no '\0']
+  A command is a program path, its arguments, and optionally, as its last
+  words in any order, the number of copies to run, "x<copies>", and the
+  weight of its processes, "w<weight>", all separated by spaces:
+    prog1 -v input.txt w200 x100
+  Only the stride and vruntime policies use the weight: they give each
+  process a share of the CPU proportional to it, so w200 gets twice the
+  share of the default, CMD_WEIGHT (see policy.h).
+  Frames are grouped in batches of at most MSG_MAX bytes, and each batch
+  is sent with one write(). MSG_MAX is PIPE_BUF, so batches of different
+  writers are never mixed.
+
+  The same frames can be sent to the Unix stream socket SOCKET_INPUT
+  instead, where every submitter has its own connection. The scheduler
+  answers each command there with a Reply, in the order of the commands.
+*/
+
+#include <limits.h>       // PIPE_BUF
+#include <stdint.h>       // int32_t
+
+#define PIPE_INPUT "./input.pipe"   // named pipe for creating new processes
+#define SOCKET_INPUT "./input.sock" // Unix socket for creating new processes
+#define MSG_MAX PIPE_BUF            // max size of a batch, in bytes
+#define CMD_MAX_ARGS 32             // max number of words of a command, with the program
+#define CMD_MAX_COPIES 100000       // max number of copies of a command
+#define CMD_WEIGHT 100              // weight of a command without w<weight>
+#define CMD_MAX_WEIGHT 10000        // max weight of a command
+
+typedef unsigned short FrameLen;
+#define FRAME_MAX (MSG_MAX - (int) sizeof(FrameLen)) // max length of a command
+
+// status of a Reply
+#define REPLY_OK 0          // all copies were created
+#define REPLY_INVALID 1     // the command is invalid, nothing was created
+#define REPLY_FAILED 2      // some copies could not be created (no memory,
+                            // too many processes...)
+
+// answer to one command sent to SOCKET_INPUT
+typedef struct {
+  int32_t status;       // REPLY_*
+  int32_t job;          // id of the first job created
+  int32_t copies;       // number of jobs created: job, job+1, ..., job+copies-1
+} Reply;
+
+// frames waiting to be written
+typedef struct {
+  char data[MSG_MAX];
+  int len;
+} Batch;
+
+// bytes read from the pipe that were not parsed yet
+// a frame takes at most MSG_MAX bytes, so there is always room for the rest
+// of an incomplete one
+typedef struct {
+  char data[2*MSG_MAX];
+  int start;    // first byte not parsed yet
+  int len;      // end of the bytes read
+} Reader;
+
+// returns an empty batch
+Batch batch_create();
+
+// append one command to the batch
+// returns 0 if it does not fit: flush the batch and try again
+int batch_add(Batch *b, const char *cmd, int len);
+
+// write the whole batch to fd and empty it
+// returns -1 on error
+int batch_flush(Batch *b, int fd);
+
+// returns an empty reader
+Reader reader_create();
+
+// read from fd all the bytes that fit in the reader
+// returns the result of read()
+int reader_fill(Reader *r, int fd);
+
+// read from fd the rest of the frame the reader has part of, if any, so
+// that fd is left at the start of a frame
+// returns -1 on error, or if that frame is longer than FRAME_MAX
+int reader_finish(Reader *r, int fd);
+
+// copy the next command to cmd, with a '\0' in the end
+// commands longer than cmd_size-1 are truncated
+// returns the length of the command, -1 if no complete frame was read yet,
+// or -2 if the next frame is longer than FRAME_MAX: the writer does not
+// follow this protocol, and the bytes read cannot be parsed
+int reader_next(Reader *r, char *cmd, int cmd_size);
+
+// split cmd in words, in place: argv gets them, followed by NULL
+// returns the number of words, or -1 if there are more than CMD_MAX_ARGS
+int command_split(char *cmd, char *argv[CMD_MAX_ARGS+1]);
+
+// split cmd in words, in place: argv gets the program and its arguments,
+// followed by NULL, copies the number of copies (1 if not given) and
+// weight the weight (CMD_WEIGHT if not given)
+// returns the number of words in argv, or -1 if cmd is empty, has too many
+// words or an invalid number of copies or weight
+int command_parse(char *cmd, char *argv[CMD_MAX_ARGS+1], int *copies, int *weight);
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <assert.h>
+#include "readyq.h"
+
+ReadyQueue rq_create(int n_levels, int *quantum) {
+  ReadyQueue rq;
+  assert(n_levels > 0 && n_levels <= RQ_MAX_LEVELS);
+
+  rq.n_levels = n_levels;
+  rq.nonempty = 0;
+  rq.boosted_levels = 0;
+  rq.ahead = 0;
+  rq.epoch = 0;
+  for(int i=0; i < n_levels; i++) {
+    rq.levels[i] = fifo_create();
+    rq.quantum[i] = quantum[i];
+    rq.count[i] = 0;
+    rq.boosted[i] = 0;
+  }
+  return rq;
+}
+
+int rq_empty(ReadyQueue *rq) {
+  return rq->nonempty == 0 ? 1 : 0;
+}
+
+void rq_print(ReadyQueue *rq) {
+  for(int i=0; i < rq->n_levels; i++) {
+    printf("FIFO F%d (%d UT) = ", i+1, rq->quantum[i]);
+    fifo_print(&rq->levels[i]);
+    if(rq->boosted[i] > 0) {
+      printf(" (first %d boosted to F1)", rq->boosted[i]);
+    }
+    printf("\n");
+  }
+}
+
+void rq_put(ReadyQueue *rq, int level, int fid) {
+  fifo_put(&rq->levels[level], fid);
+  rq->count[level]++;
+  rq->nonempty |= 1u << level;
+}
+
+// one process less in this level, and in its boosted ones if it was one
+static void rq_removed(ReadyQueue *rq, int level, int boosted) {
+  if(--rq->count[level] == 0) {
+    rq->nonempty &= ~(1u << level);
+  }
+  if(boosted && --rq->boosted[level] == 0) {
+    rq->boosted_levels &= ~(1u << level);
+  }
+}
+
+int rq_take(ReadyQueue *rq, int *level) {
+  if(rq_empty(rq)) {
+    return -1;
+  }
+
+  // boosted processes come after the ones that were at level 0 when they
+  // were boosted
+  if(rq->boosted_levels != 0 && rq->ahead == 0) {
+    int from = __builtin_ctz(rq->boosted_levels);
+    int fid = fifo_take(&rq->levels[from]);
+    rq_removed(rq, from, 1);
+    *level = 0;
+    return fid;
+  }
+  // the lowest set bit is the highest priority non-empty level
+  *level = __builtin_ctz(rq->nonempty);
+  int fid = fifo_take(&rq->levels[*level]);
+  rq_removed(rq, *level, 0);
+  if(*level == 0 && rq->ahead > 0) {
+    rq->ahead--;
+  }
+  return fid;
+}
+
+int rq_steal(ReadyQueue *rq, int *level) {
+  if(rq_empty(rq)) {
+    return -1;
+  }
+
+  if(rq->boosted_levels != 0 && rq->count[0] == rq->ahead) {
+    // only the first ones of a level can be boosted, so this is not the
+    // last one in the order of rq_take
+    int from = 31 - __builtin_clz(rq->boosted_levels);
+    int fid = fifo_take(&rq->levels[from]);
+    rq_removed(rq, from, 1);
+    *level = 0;
+    return fid;
+  }
+  *level = __builtin_ctz(rq->nonempty);
+  int fid = fifo_take_last(&rq->levels[*level]);
+  rq_removed(rq, *level, 0);
+  if(*level == 0 && rq->ahead > rq->count[0]) {
+    rq->ahead--;
+  }
+  return fid;
+}
+
+int rq_remove(ReadyQueue *rq, int level, int fid) {
+  int i = fifo_index(&rq->levels[level], fid);
+  if(i < 0) {
+    return 0;
+  }
+  fifo_remove(&rq->levels[level], fid);
+  rq_removed(rq, level, i < rq->boosted[level]);
+  if(level == 0 && i < rq->ahead) {
+    rq->ahead--;
+  }
+  return 1;
+}
+
+void rq_boost(ReadyQueue *rq) {
+  // processes boosted before and still waiting keep their place, after
+  // the ones that were at level 0 then
+  if(rq->boosted_levels == 0) {
+    rq->ahead = rq->count[0];
+  }
+  // everything waiting below level 0 now is boosted
+  for(int i=1; i < rq->n_levels; i++) {
+    rq->boosted[i] = rq->count[i];
+    if(rq->count[i] > 0) {
+      rq->boosted_levels |= 1u << i;
+    }
+  }
+  rq->epoch++;
+}
+
+void rq_free(ReadyQueue *rq) {
+  for(int i=0; i < rq->n_levels; i++) {
+    fifo_free(&rq->levels[i]);
+    rq->count[i] = 0;
+    rq->boosted[i] = 0;
+  }
+  rq->nonempty = 0;
+  rq->boosted_levels = 0;
+  rq->ahead = 0;
+}
@@ -0,0 +1,58 @@
+#include "fifo.h"
+
+#define RQ_MAX_LEVELS 32  // one bit per level in ReadyQueue.nonempty
+
+// multilevel ready queue: one fifo per priority level plus a bitmap of
+// the non-empty levels, so finding the next process is a find-first-set
+//
+// a boost moves every waiting process to the end of the highest priority
+// level, so that none of them starves. Instead of moving them, it only
+// remembers how many are at the start of each level, and how many were at
+// level 0: those are taken as if they were at level 0, after the ones that
+// were there and before the ones put there later. It costs one step per
+// level, however many processes are waiting
+typedef struct {
+  Fifo levels[RQ_MAX_LEVELS];   // levels[0] has the highest priority
+  int quantum[RQ_MAX_LEVELS];   // quantum of each level, in UT
+  int count[RQ_MAX_LEVELS];     // number of processes in each level
+  int boosted[RQ_MAX_LEVELS];   // the first boosted[i] of levels[i] are boosted
+  int ahead;                    // the first 'ahead' of levels[0] go before them
+  int n_levels;                 // number of levels in use
+  unsigned int nonempty;        // bit i is set if levels[i] is not empty
+  unsigned int boosted_levels;  // bit i is set if boosted[i] > 0
+  unsigned int epoch;           // number of boosts so far
+} ReadyQueue;
+
+// returns an empty ready queue with n_levels levels
+// quantum[i] is the quantum of level i, in UT
+ReadyQueue rq_create(int n_levels, int *quantum);
+
+// are all levels empty?
+int rq_empty(ReadyQueue *rq);
+
+void rq_print(ReadyQueue *rq);
+
+// add fid to the end of the given level
+void rq_put(ReadyQueue *rq, int level, int fid);
+
+// remove and return the first fid of the highest priority non-empty level
+// level is set to its level, which is 0 if it was boosted
+// returns -1 if all levels are empty
+int rq_take(ReadyQueue *rq, int *level);
+
+// remove and return the last fid of the highest priority non-empty level
+// (or the first boosted one of the last level with any, if they are the
+// last ones of level 0) this is what other workers steal, see scheduler.c
+// level is set to its level, which is 0 if it was boosted
+// returns -1 if all levels are empty
+int rq_steal(ReadyQueue *rq, int *level);
+
+// remove fid from the given level, where it was put
+// returns 0 if it was not there
+int rq_remove(ReadyQueue *rq, int level, int fid);
+
+// move all processes waiting in lower levels to the highest one
+void rq_boost(ReadyQueue *rq);
+
+// free all levels
+void rq_free(ReadyQueue *rq);
@@ -0,0 +1,52 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "ring.h"
+
+Ring ring_create(unsigned int size, unsigned int elem_size) {
+  Ring r;
+  r.size = 1;
+  while(r.size < size) {
+    r.size *= 2;
+  }
+  r.elem_size = elem_size;
+  r.data = malloc((size_t) r.size * elem_size);
+  assert(r.data != NULL);
+  atomic_init(&r.head, 0);
+  atomic_init(&r.tail, 0);
+  return r;
+}
+
+// head and tail only grow (wrapping around UINT_MAX), so tail-head is
+// always the number of elements in the ring
+
+int ring_push(Ring *r, const void *elem) {
+  unsigned int tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+  unsigned int head = atomic_load_explicit(&r->head, memory_order_acquire);
+  if(tail - head == r->size) {
+    return 0;
+  }
+
+  memcpy(r->data + (size_t) (tail & (r->size-1)) * r->elem_size, elem, r->elem_size);
+  // publish the element only after it is written
+  atomic_store_explicit(&r->tail, tail+1, memory_order_release);
+  return 1;
+}
+
+int ring_pop(Ring *r, void *elem) {
+  unsigned int head = atomic_load_explicit(&r->head, memory_order_relaxed);
+  unsigned int tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+  if(tail == head) {
+    return 0;
+  }
+
+  memcpy(elem, r->data + (size_t) (head & (r->size-1)) * r->elem_size, r->elem_size);
+  // free the slot only after it is read
+  atomic_store_explicit(&r->head, head+1, memory_order_release);
+  return 1;
+}
+
+void ring_free(Ring *r) {
+  free(r->data);
+  r->data = NULL;
+}
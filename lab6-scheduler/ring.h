@@ -0,0 +1,24 @@
+#include <stdatomic.h>
+
+// lock-free single-producer/single-consumer ring of fixed size elements
+// one thread may only call ring_push and another one may only call ring_pop
+typedef struct {
+  char *data;                 // 'size' elements of 'elem_size' bytes
+  unsigned int size;          // number of elements, always a power of 2
+  unsigned int elem_size;
+  _Alignas(64) atomic_uint head;  // next element to pop, written by the consumer
+  _Alignas(64) atomic_uint tail;  // next element to push, written by the producer
+} Ring;
+
+// returns an empty ring with room for size elements (rounded up to a power of 2)
+Ring ring_create(unsigned int size, unsigned int elem_size);
+
+// copy elem to the end of the ring
+// returns 0 if the ring is full
+int ring_push(Ring *r, const void *elem);
+
+// copy the first element of the ring to elem and remove it
+// returns 0 if the ring is empty
+int ring_pop(Ring *r, void *elem);
+
+void ring_free(Ring *r);
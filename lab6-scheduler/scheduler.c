@@ -1,308 +1,1496 @@
 /*
-  gcc scheduler.c fifo.c -pthread -o scheduler; ./scheduler
+  gcc scheduler.c sim.c mlfq.c proctable.c readyq.c fifo.c ring.c protocol.c stats.c preempt.c procwatch.c spawner.c trace.c policy.c stride.c vruntime.c vtree.c -pthread -o scheduler; ./scheduler [-u 2000000] [-q 1,2,4] [-a 21] [-c workers] [-p signal|stop|freezer] [-g cgroup] [-b 10000] [-f fork|spawn] [-w 0] [-n jobs] [-t trace] [-l 1] [-s workload] [-P mlfq|stride|vruntime] [-r]
+
+  -u: the time unit (UT), in microsseconds. Processes started by the
+      scheduler get it in the SCHED_UT_US environment variable. The
+      default is SCHED_UT_US, if it is set, or 2 seconds.
+
+  -q: quantum of each queue level, in UT, from the highest to the lowest
+      priority. The number of values is the number of levels.
+  -a: every this many UT, all processes go back to the highest priority
+      level, so that long processes do not starve behind a stream of
+      short ones (see mlfq.h). 0 disables it. The default is 3 times the
+      sum of the quanta of -q (21 UT for 1,2,4).
+  -c: number of workers. Each worker has its own queues and runs one
+      process at a time, pinned to its own CPU. Idle workers steal
+      processes from the others. Without -c, there is one worker and
+      processes are not pinned.
+  -p: how processes are stopped when their quantum ends (see preempt.h).
+      "signal" (the default) asks them with SIGUSR1, so it only works with
+      programs written for this scheduler. "stop" uses SIGSTOP/SIGCONT and
+      "freezer" the cgroup v2 freezer, and work with any program. The mode
+      is given to processes in the SCHED_PREEMPT environment variable.
+  -g: with -p freezer, the cgroup where the cgroup of each process is
+      created. The default is /sys/fs/cgroup/scheduler.
+  -b: with -p stop or freezer, how often to look at /proc for processes
+      that block on their own (disk, network, pipes...), in microsseconds.
+      They are handled like processes that report their IO (see
+      preempt.h). 0 disables it. The default is 10000.
+  -f: how processes are created: "fork" (the default) or "spawn"
+      (posix_spawn, faster, only with -p signal). See spawner.h.
+  -w: number of processes created and parked in advance for each program
+      that is submitted often, so that admitting it does not wait for a
+      new process. The default is 0 (no pools).
+  -n: exit, as with SIGTERM, when this number of jobs ended. Used by
+      bench.sh.
+  -t: record every admission, dispatch, preemption, IO and exit in this
+      binary file (see trace.h). Decode it with tracedump. With -r, the
+      records are appended to the trace of the last run.
+  -l: 0 turns off the log of every decision on stdout. The default is 1.
+  -s: do not run any process: simulate the workload described in the
+      given file against a virtual clock and print the timeline (see sim.c)
+  -P: the scheduling policy: "mlfq" (the default), "stride" or "vruntime"
+      (see policy.h). stride and vruntime only use the first quantum of
+      -q, and ignore -a. They share the CPU by the weight of each job, given
+      by its command (see protocol.h).
+  -r: take back the processes of the last run from scheduler.state (see
+      below), instead of starting without any. -P and -p must be the same.
+
+  Jobs are submitted by interpreters through the pipe ./input.pipe, or
+  through the socket ./input.sock, which serves many of them at once and
+  replies with the ids of the jobs (see protocol.h).
+
+  Each process is watched through a pidfd, which tells when it ends, and
+  is reaped with its exit status.
+
+  The process table is kept in scheduler.state, mapped in memory, so the
+  file always has the state of every process (see proctable.h): its
+  worker, whether it is running, waiting (and when it joined its queue) or
+  doing IO, and its state in the policy. A run with -r takes back the ones
+  that are still alive in milliseconds, and puts them back in their queues
+  in the same order, with the same priorities. The ones that were running
+  are stopped first. The global counters are kept there too, so the
+  stats, and -n, go on counting from where the last run was.
+  SIGUSR1 restarts the scheduler in place: it execs itself again (a new
+  build, if there is one) with -r, so its processes stay its children, and
+  commands waiting in the pipe are not lost. Clients of the socket must
+  connect again. After a crash, the processes taken back by -r are not our
+  children anymore: their exit status is unknown, and the ones that report
+  their IO (-p signal) report it to init.
+
+  Send SIGHUP to write scheduler.stats.json. It is also written when the
+  scheduler ends (SIGINT or SIGTERM). Ended processes are appended to
+  scheduler.jobs.csv.
 */
 
+#define _GNU_SOURCE       // sched_setaffinity, CPU_SET
 #include <stdio.h>
+#include <stdlib.h>       // exit, atoi
+#include <limits.h>       // INT_MAX
 #include <unistd.h>
 #include <string.h>
 #include <fcntl.h>        // open, close
 #include <pthread.h>      // pthread, pthread_create
 #include <signal.h>       // sigaction, kill
+#include <sched.h>        // sched_setaffinity
+#include <sys/prctl.h>    // prctl, PR_SET_TIMERSLACK
+#include <stdint.h>       // uint64_t
+#include <stdatomic.h>    // atomic_int
+#include <errno.h>        // errno, EINTR
 #include <sys/stat.h>     // mkfifo
-#include <sys/time.h>     // gettimeofday
-#include <sys/wait.h>     // WNOHANG
+#include <sys/wait.h>     // waitid, waitpid
+#include <sys/epoll.h>    // epoll_create1, epoll_ctl, epoll_wait
+#include <sys/signalfd.h> // signalfd
+#include <sys/timerfd.h>  // timerfd_create, timerfd_settime
+#include <sys/eventfd.h>  // eventfd
+#include <sys/pidfd.h>    // pidfd_open
+#include <sys/socket.h>   // socket, bind, listen, accept4, send
+#include <sys/un.h>       // sockaddr_un
+
+#include "mlfq.h"
+#include "sim.h"
+#include "proctable.h"
+#include "ring.h"
+#include "protocol.h"
+#include "preempt.h"
+#include "procwatch.h"
+#include "spawner.h"
+#include "trace.h"
 
-#include "fifo.h"
+#define MAX_EVENTS 8    // max number of epoll events handled per wakeup
+#define DEFAULT_QUANTA "1,2,4"  // default quantum of each level, in UT
+#define ADMIT_RING_SIZE 1024    // max number of admissions waiting for the scheduler
+#define DEFAULT_SAMPLE 10000    // period of sample(), in microsseconds
+#define STATE_FILE "./scheduler.state"  // where the process table is kept
+#define PIPE_FD_ENV "SCHED_PIPE_FD" // fd of PIPE_INPUT, kept by a restart in place
 
-#define PIPE_INPUT "./input.pipe" // named pipe for incoming new processes
+// epoll events are tagged with their kind in the high 32 bits and an
+// index (the worker, for timers) in the low 32 bits
+#define EV_SIGNAL 1     // signal_fd
+#define EV_WAKE 2       // wake_fd
+#define EV_TIMER 3      // timer_fd of a worker
+#define EV_SAMPLE 4     // sample_fd
+#define EV_PIDFD 5      // pidfd of a process (the index is its fid)
+#define EV_BOOST 6      // boost_fd
+#define EV_STOPPED 7    // preempt_fd
 
-#define BUF_SIZE 255    // max size of string buffers
-#define MAX_PROCS 64    // max number of process this scheduler can handle
-#define UT 2            // in seconds
+// console log of every decision, see -l
+#define LOG(...) do { if(log_console) printf(__VA_ARGS__); } while(0)
 
+// a process created by the pipe thread, to be added to the scheduler state
 typedef struct {
-  int fid;              // "FIFO id"  = id of this process in this scheduler
-  int pid;              // "unix pid" = id of this process in the OS
-  int priority;         // 1 for fifo_f1, 2 for fifo_f2, 4 for fifo_f3
-  char prog[BUF_SIZE];  // path of the file containing the code this process may run
-} Process;
+  int pid;
+  int job;
+  double submitted;     // when the pipe thread read it
+  int weight;           // of its SchedEntity
+  char prog[BUF_SIZE];
+} Admission;
+
+// a worker runs one process at a time, chosen from its own queues
+typedef struct {
+  int id;               // index in 'workers'
+  int cpu;              // CPU its processes are pinned to, or -1
+  void *rq;             // ready queue of the policy
+  int n_ready;          // number of processes in rq
+  int running;          // fid of the running process, or -1
+  double run_start;     // when the running process was signaled to run
+  double idle_since;    // when the last process stopped running
+  int quantum;          // quantum of the running process, in microsseconds
+  int timer_fd;         // expires when the quantum of the running process ends
+  double sampled_at;    // when sample() last looked at the running process
+} Worker;
+
+// reasons for a process to stop running
+#define STOP_QUANTUM 0  // it achieved the quantum
+#define STOP_IO 1       // it started an IO operation
+#define STOP_END 2      // it ended
 
 
 
 /***** scheduler state *****/
 
-Fifo fifo_f1, fifo_f2, fifo_f3; // integer fifos
-Process processes[MAX_PROCS];   // the index here is the p.fid
-int n_of_processes = 0;         // the length of 'processes' list
+// only the main thread touches the state below
+// the pipe thread sends new processes through 'admissions'
 
-int flag_io;  // flag "the running process started an IO operation"
-int flag_end; // flag "the running process ended"
+Worker *workers;                // each one with its own queues
+int n_workers = 1;
+ProcTable processes;            // processes indexed by fid, pid and prog
+Fifo blocked;                   // fids of processes that sample() saw block
+int n_blocked;
+int sample_period = DEFAULT_SAMPLE; // of sample(), in microsseconds, or 0
+int exit_after = 0;             // exit when this many jobs ended, or 0
+int log_console = 1;            // print every decision to stdout
+double batch_start;             // when the current batch of events arrived
+
+Ring admissions;                // pipe thread -> main thread
+
+int epoll_fd;     // waits for any of the fds below and the timer_fd of workers
+int signal_fd;    // receives SIG_IO, SIGHUP, SIGUSR1, SIGINT and SIGTERM
+int wake_fd;      // written by the pipe thread after pushing admissions
+int sample_fd;    // expires every sample_period
+int boost_fd;     // expires every boost_period UT
+
+char **restart_args;            // exec'd by restart()
+int restart_asked = 0;          // restart() runs once the pipe thread stops
+atomic_int input_stopped;       // set by the pipe thread when it stops
 
 
 
 /***** auxiliary functions *****/
 
+// the policy keeps its state of each process in the process table
+SchedEntity *entity_of(int fid) {
+  return &pt_get(&processes, fid)->se;
+}
+
 void print_proc(Process *p) {
-  printf("  {fid: %d, pid: %d, prog: %s, priority: %d},\n",
-        p->fid, p->pid, p->prog, p->priority);
+  if(!log_console) {
+    return;
+  }
+  printf("  {job: %d, fid: %d, pid: %d, prog: %s, priority: %d},\n",
+        p->job, p->fid, p->pid, p->prog, p->se.priority);
 }
 
 // not thread-safe
 void print_processes() {
+  if(!log_console) {
+    return;
+  }
   printf("Processes = [\n");
-  for(int i=0; i < n_of_processes; i++) {
-    print_proc(&processes[i]);
+  for(int fid=0; fid < processes.size; fid++) {
+    Process *p = pt_get(&processes, fid);
+    if(p != NULL) {
+      print_proc(p);
+    }
   }
   printf("]\n");
 }
 
 // not thread safe
-void print_fifos() {
-  printf("FIFO F1 = ");
-  fifo_print(&fifo_f1);
-  printf("\nFIFO F2 = ");
-  fifo_print(&fifo_f2);
-  printf("\nFIFO F3 = ");
-  fifo_print(&fifo_f3);
-  printf("\n");
-}
-
-// get the higher priority process of all 3 queues
-// returns -1 if all queues are empty
-int dequeue() {
-  // try to get from fifo f1
-  int fid = fifo_take(&fifo_f1);
-  if(fid < 0) {
-    // f1 empty: try f2
-    fid = fifo_take(&fifo_f2);
-    if(fid < 0) {
-      // f2 empty: try f3
-      fid = fifo_take(&fifo_f3);
+void print_fifos(Worker *w) {
+  if(!log_console) {
+    return;
+  }
+  if(n_workers > 1) {
+    printf("Worker %d:\n", w->id);
+  }
+  policy->print(w->rq);
+}
+
+// take the process that runs next from the queue of the worker
+// returns -1 if it is empty
+int dequeue(Worker *w) {
+  int fid = policy->pick_next(w->rq);
+  if(fid >= 0) {
+    Process *p = pt_get(&processes, fid);
+    p->queued = 0;
+    w->n_ready--;
+    stats_dequeue(&p->stats);
+  }
+  return fid;
+}
+
+// the policy put the process in the queue of its worker
+void enqueued(Process *p) {
+  Worker *w = &workers[p->worker];
+  p->queued = 1;
+  p->seq = processes.header->next_seq++;
+  w->n_ready++;
+  stats_enqueue(&p->stats, p->se.priority);
+}
+
+// take a process from the worker with most processes ready
+// the policy gives the one that would wait longer there
+// returns -1 if there is nothing to steal
+int steal(Worker *thief) {
+  Worker *victim = NULL;
+  for(int i=0; i < n_workers; i++) {
+    if(&workers[i] != thief && workers[i].n_ready > 0 &&
+       (victim == NULL || workers[i].n_ready > victim->n_ready)) {
+      victim = &workers[i];
     }
   }
+  if(victim == NULL) {
+    return -1;
+  }
+
+  int fid = policy->steal(victim->rq, thief->rq);
+  Process *p = pt_get(&processes, fid);
+  p->queued = 0;
+  p->worker = thief->id;
+  victim->n_ready--;
+  stats_dequeue(&p->stats);
+  LOG("[SCHEDULER] worker %d stole %d from worker %d\n", thief->id, p->pid, victim->id);
   return fid;
 }
 
-// put process in a queue, according to its current priority
-int enqueue(Process *p) {
-  if(p->priority == 1) {
-    fifo_put(&fifo_f1, p->fid);
-  } else if(p->priority == 2) {
-    fifo_put(&fifo_f2, p->fid);
-  } else {
-    fifo_put(&fifo_f3, p->fid);
+// the worker with less processes, for new processes
+Worker *least_loaded() {
+  Worker *best = &workers[0];
+  for(int i=1; i < n_workers; i++) {
+    int load = workers[i].n_ready + (workers[i].running >= 0);
+    if(load < best->n_ready + (best->running >= 0)) {
+      best = &workers[i];
+    }
+  }
+  return best;
+}
+
+// write the global counters and the counters of every process to STATS_FILE
+// the file is replaced at once, so readers never see half of it
+void write_stats() {
+  int first = 1;
+  FILE *f = fopen(STATS_FILE ".tmp", "w");
+  if(f == NULL) {
+    return;
+  }
+
+  fprintf(f, "{\n");
+  stats_write_global(f);
+  fprintf(f, ",\n\"processes\": [");
+  for(int fid=0; fid < processes.size; fid++) {
+    Process *p = pt_get(&processes, fid);
+    if(p != NULL) {
+      fprintf(f, first ? "\n  " : ",\n  ");
+      stats_write_proc(f, &p->stats, p->job, p->fid, p->pid, p->prog, p->se.priority);
+      first = 0;
+    }
   }
+  fprintf(f, "\n]}\n");
+  fclose(f);
+  rename(STATS_FILE ".tmp", STATS_FILE);
 }
 
 
 
 /***** signal handlers *****/
 
-// SIGUSR1 is used to signal an IO start
+// these are not real signal handlers: all these signals are blocked and
+// read from signal_fd by the dispatcher, so they run in the main loop
+
+void stop_running(Worker *w, int reason);
+void quit();
+
+// SIG_IO with IO_START: the sender started an IO
 // get sender pid and block this process
-void sigusr1_handler(int signo, siginfo_t *si, void *data) {
-  int sender = (unsigned long)si->si_pid;
-  printf("[SCHEDULER] [SIGUSR1] received a SIGUSR1 from %d\n", sender);
+void io_start_handler(struct signalfd_siginfo *si) {
+  int sender = si->ssi_pid;
+  LOG("[SCHEDULER] [IO_START] received an IO start from %d\n", sender);
 
   // block running process
-  flag_io = 1;
+  int fid = pt_find_pid(&processes, sender);
+  if(fid >= 0 && workers[pt_get(&processes, fid)->worker].running == fid) {
+    stop_running(&workers[pt_get(&processes, fid)->worker], STOP_IO);
+  }
 }
 
-// SIGUSR2 is used to signal an IO end
+// SIG_IO with IO_END: the sender ended its IO
 // get sender pid and unblock this process
-void sigusr2_handler(int signo, siginfo_t *si, void *data) {
-  int pid = (unsigned long)si->si_pid;
-  int fid;
-  printf("[SCHEDULER] [SIGUSR2] received a SIGUSR2 from %d\n", pid);
+void io_end_handler(struct signalfd_siginfo *si) {
+  int pid = si->ssi_pid;
+  LOG("[SCHEDULER] [IO_END] received an IO end from %d\n", pid);
 
   // find the fid of the sender
-  for(int i=0; i < n_of_processes; i++) {
-    if(processes[i].pid == pid) {
-      fid = processes[i].fid;
-      break;
-    }
+  int fid = pt_find_pid(&processes, pid);
+  if(fid < 0) {
+    LOG("[SCHEDULER] [IO_END] %d is not one of our processes\n", pid);
+    return;
+  }
+
+  Process *p = pt_get(&processes, fid);
+  Worker *w = &workers[p->worker];
+  if(p->queued) {
+    // it is already waiting for its turn
+    return;
+  }
+  if(w->running == fid) {
+    // its quantum ended just as it started the IO, so we ignored its
+    // IO_START, and it ran again: it is waiting to be resumed now
+    stop_running(w, STOP_IO);
+  } else if(p->blocked) {
+    // the sampler saw it blocking before it told us
+    fifo_remove(&blocked, fid);
+    p->blocked = 0;
+    n_blocked--;
   }
 
   // process unblocked -> add it to the right queue
-  printf("[SCHEDULER] [SIGUSR2] process unblocked:");
-  print_proc(&processes[fid]);
-  enqueue(&processes[fid]);
+  LOG("[SCHEDULER] [IO_END] process unblocked:");
+  print_proc(p);
+  if(preempt_mode != PREEMPT_SIGNAL) {
+    // it does not stop itself to wait for its turn
+    preempt_stop(pid);
+  }
+  policy->on_wake(w->rq, fid);
+  enqueued(p);
+  trace_event(TR_IO_END, p->worker, p->se.priority, p->job, p->pid, 0);
 }
 
-  // SIGCHLD is used to signal that a process ended
-  void sigchld_handler(int signo, siginfo_t *si, void *data) {
-    int sender = (unsigned long)si->si_pid;
-    printf("[SCHEDULER] [SIGCHLD] received a SIGCHLD from %d\n", sender);
+// the pidfd of a process became readable: it ended
+// reap it and free its slot in the process table
+void pidfd_handler(int fid) {
+  siginfo_t info;
+  Process *p = pt_get(&processes, fid);
+  int status = STATUS_UNKNOWN;
 
-    // block running process forever
-    flag_end = 1;
+  info.si_pid = 0;
+  if(waitid(P_PIDFD, p->pidfd, &info, WEXITED | WNOHANG) == 0) {
+    if(info.si_pid == 0) {
+      // it did not end yet
+      return;
+    }
+    status = info.si_code == CLD_EXITED ? info.si_status : -info.si_status;
   }
+  // otherwise it is not our child: we took it back after a crash (see
+  // restore), and only its parent can know how it ended
+  trace_event(TR_EXIT, p->worker, p->se.priority, p->job, p->pid, status);
 
+  Worker *w = &workers[p->worker];
+  if(w->running == fid) {
+    // free its worker
+    stop_running(w, STOP_END);
+  }
+  policy->on_exit(w->rq, fid, p->queued);
+  if(p->queued) {
+    // it was killed while waiting
+    p->queued = 0;
+    w->n_ready--;
+  } else if(p->blocked) {
+    fifo_remove(&blocked, fid);
+    n_blocked--;
+  }
+  LOG("[SCHEDULER] %d ended with status %d. Removing it from the table.\n", p->pid, status);
+  // children that did not exec yet share the pidfd, so closing it would not
+  // remove it from epoll_fd
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, p->pidfd, NULL);
+  close(p->pidfd);
+  preempt_release(p->pid);
+  stats_end(&p->stats, p->job, fid, p->pid, p->prog, status);
+  pt_remove(&processes, fid);
 
-/***** pipe handlers *****/
+  if(exit_after > 0 && stats->ended >= exit_after) {
+    LOG("[SCHEDULER] %d jobs ended, exiting\n", exit_after);
+    quit();
+  }
+}
 
-// this thread handles interpreter input (create new processes)
-void *t_pipe_input_main(void *arg) {
-  int pipe_fd, pid, next_fid;
-  char program_name[BUF_SIZE];
+// SIGHUP asks for the stats file
+void sighup_handler(struct signalfd_siginfo *si) {
+  LOG("[SCHEDULER] [SIGHUP] writing %s\n", STATS_FILE);
+  write_stats();
+}
 
-  printf("[PIPE THREAD] started thread\n");
+void ask_restart();
+void stop_pipe_thread();
 
-  // create named pipe (FIFO)
-  mkfifo(PIPE_INPUT, 0666);
+// SIGUSR1 restarts the scheduler in place
+void sigusr1_handler(struct signalfd_siginfo *si) {
+  LOG("[SCHEDULER] [SIGUSR1] restarting\n");
+  ask_restart();
+}
 
-  while(1) {
-    pipe_fd = open(PIPE_INPUT, O_RDONLY);
-    read(pipe_fd, program_name, BUF_SIZE);
-    close(pipe_fd);
-
-    // ignore repeated programs
-    int flag_repeated = 0;
-    for(int i=0; i<n_of_processes; i++) {
-      if(strcmp(processes[i].prog, program_name) == 0) {
-        flag_repeated = 1;
-        break;
-      }
-    }
-    if (flag_repeated) continue;
+// SIGINT and SIGTERM end the scheduler and all its processes
+void sigterm_handler(struct signalfd_siginfo *si) {
+  LOG("[SCHEDULER] received signal %d, exiting\n", si->ssi_signo);
+  quit();
+}
 
-    next_fid = n_of_processes;
-    n_of_processes++;
+// write the stats and end the scheduler and all its processes
+void quit() {
+  // it may be creating processes and refilling the pools
+  stop_pipe_thread();
 
-    // create child process for this program
-    if((pid=fork()) == 0) {
-      char *args[] = {program_name, NULL};
-      execv(args[0], args);
-      return NULL;
+  write_stats();
+  long dropped = trace_stop();
+  if(dropped > 0) {
+    LOG("[SCHEDULER] %ld trace events were dropped\n", dropped);
+  }
+  for(int fid=0; fid < processes.size; fid++) {
+    Process *p = pt_get(&processes, fid);
+    if(p != NULL) {
+      kill(p->pid, SIGKILL);
+    }
+  }
+  spawner_kill_pools();
+  while(wait(NULL) > 0);
+  for(int fid=0; fid < processes.size; fid++) {
+    Process *p = pt_get(&processes, fid);
+    if(p != NULL) {
+      preempt_release(p->pid);
+      // so that -r does not take it back
+      pt_remove(&processes, fid);
     }
+  }
+  exit(0);
+}
+
+
 
-    /*** only the parent (scheduler) gets here ***/
+/***** admissions *****/
 
-    // create new process data
-    Process new_proc;
-    new_proc.pid = pid;
-    new_proc.fid = next_fid;
-    new_proc.priority = 1;
-    strcpy(new_proc.prog, program_name);
+void watch_fd(int fd, int kind, int index);
 
-    // add process data to the state of scheduler
-    processes[next_fid] = new_proc;
-    fifo_put(&fifo_f1, next_fid);
+// kill a process that will not be admitted, and reap it
+void reject(int pid) {
+  kill(pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+}
+
+// add all processes sent by the pipe thread to the table and to the first level
+void admit() {
+  Admission a;
+  Process *p;
+  int admitted = 0;
+
+  while(ring_pop(&admissions, &a)) {
+    double latency = stats_now() - a.submitted;
+    stats_admission(latency);
+
+    // only we reap our children, so even if it already ended its pid was
+    // not reused and the pidfd is readable at once
+    int pidfd = pidfd_open(a.pid, 0);
+    if(pidfd < 0) {
+      LOG("[SCHEDULER] Cannot watch %d, killing %s\n", a.pid, a.prog);
+      reject(a.pid);
+      continue;
+    }
+    if((p = pt_add(&processes, a.pid, a.job, a.prog)) == NULL) {
+      LOG("[SCHEDULER] Too many processes, killing %s\n", a.prog);
+      close(pidfd);
+      reject(a.pid);
+      continue;
+    }
+    p->pidfd = pidfd;
+    p->admitted_at = procwatch_boottime();
+    watch_fd(pidfd, EV_PIDFD, p->fid);
+    stats_admit(&p->stats);
+    p->worker = least_loaded()->id;
+    p->se.weight = a.weight;
+    policy->admit(workers[p->worker].rq, p->fid);
+    enqueued(p);
+    trace_event(TR_ADMIT, p->worker, p->se.priority, p->job, p->pid, (int) latency);
 
-    // print new state
-    printf("[PIPE THREAD] Created new process:");
-    print_proc(&processes[next_fid]);
+    LOG("[SCHEDULER] Admitted new process:");
+    print_proc(p);
+    admitted++;
+  }
 
+  if(admitted > 0) {
     print_processes();
-    // print_fifos();
   }
-  return NULL;
 }
 
 
-int main() {
-  int fid, quantum;
-  pthread_t t_pipe_input;
-  struct sigaction sa1, sa2, sa3;
-  struct timeval tv1, tv2;
-  double runtime;
-  Process *p;
 
-  printf("[SCHEDULER] started scheduler with pid %d\n", getpid());
+/***** dispatch *****/
 
-  // init queues
-  fifo_f1 = fifo_create();
-  fifo_f2 = fifo_create();
-  fifo_f3 = fifo_create();
+// start the quantum timer of the worker, in microsseconds
+// a quantum of 0 disarms the timer
+void set_timer(Worker *w, int quantum) {
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  its.it_value.tv_sec = quantum / 1000000;
+  its.it_value.tv_nsec = (long) (quantum % 1000000) * 1000;
+  timerfd_settime(w->timer_fd, 0, &its, NULL);
+}
 
-  // set handler for SIGUSR1 -> "IO start signal"
-  memset(&sa1, 0, sizeof(sa1));
-  sa1.sa_flags = SA_SIGINFO;
-  sa1.sa_sigaction = sigusr1_handler;
-  sigaction(SIGUSR1, &sa1, 0);
+// pin the process to the CPU of the worker
+void pin(Worker *w, Process *p) {
+  cpu_set_t set;
+  if(w->cpu < 0) {
+    return;
+  }
+  CPU_ZERO(&set);
+  CPU_SET(w->cpu, &set);
+  sched_setaffinity(p->pid, sizeof(set), &set);
+}
 
-  // set handler for SIGUSR2 -> "IO end signal"
-  memset(&sa2, 0, sizeof(sa2));
-  sa2.sa_flags = SA_SIGINFO;
-  sa2.sa_sigaction = sigusr2_handler;
-  sigaction(SIGUSR2, &sa2, 0);
+// run the next process of the worker, or one stolen from another worker
+// if may_steal, for its quantum, or until it stops for IO or ends
+// does nothing if there is no process to run
+void dispatch(Worker *w, int may_steal) {
+  // get next process to run
+  int fid = dequeue(w);
+  if(fid < 0 && (!may_steal || (fid = steal(w)) < 0)) {
+    // all queues are empty: the worker stays idle
+    return;
+  }
+  Process *p = pt_get(&processes, fid);
 
-  // set handler for SIGCHLD -> "process finished signal"
-  memset(&sa3, 0, sizeof(sa2));
-  sa3.sa_flags = SA_SIGINFO;
-  sa3.sa_sigaction = sigchld_handler;
-  sigaction(SIGCHLD, &sa3, 0);
+  // print all queues every time we choose a process to run
+  LOG("\n");
+  print_fifos(w);
+  LOG("\n");
+  LOG("[SCHEDULER] next process to run:");
+  print_proc(p);
 
-  // start thread to handle input from interpreter
-  pthread_create(&t_pipe_input, NULL, t_pipe_input_main, NULL);
+  w->running = fid;
+  p->running = 1;
+  w->quantum = policy->quantum_for(w->rq, fid);
+  w->run_start = stats_now();
+  set_timer(w, w->quantum);
+  pin(w, p);
+  if(sample_period > 0) {
+    ProcSample s;
+    if(procwatch_sample(p->pid, &s) == 0) {
+      p->cpu_seen = s.cpu;
+    }
+    w->sampled_at = w->run_start;
+  }
+  // the dispatch latency counts from when the worker became idle, or from
+  // when we woke up if it was idle before that
+  stats_dispatch(&p->stats, w->run_start -
+                 (w->idle_since > batch_start ? w->idle_since : batch_start));
+  trace_event(TR_DISPATCH, w->id, p->se.priority, p->job, p->pid, w->quantum);
+  preempt_resume(p->pid);
+}
 
-  while(1) {
-    // we don't actually need this sleep(1) but it helps seeing the logs
-    // without it, logs of the scheduler are mixed with logs of child procs
-    sleep(1);
-
-    // print all queues every time we will choose a process to run
-    printf("\n");
-    print_fifos();
-    printf("\n");
-
-    // get next process to run
-    fid = dequeue();
-    if(fid < 0) {
-      // all queues are empty: wait and retry
-      sleep(1);
+// the running process of the worker stopped running
+void stop_running(Worker *w, int reason) {
+  Process *p = pt_get(&processes, w->running);
+  double runtime = stats_now() - w->run_start;
+
+  set_timer(w, 0);
+  w->running = -1;
+  p->running = 0;
+  w->idle_since = stats_now();
+  stats_run(&p->stats, runtime, reason == STOP_QUANTUM, reason == STOP_IO);
+
+  if(reason == STOP_END) {
+    // the process will be removed from the table by pidfd_handler
+    // it is not in any queue, so we will just ignore it from now on
+    return;
+  }
+
+  if(reason == STOP_IO) {
+    LOG("[SCHEDULER] %d is running an IO operation. CPU is free.\n", p->pid);
+
+    // keep process out of any queue
+    // it will join a queue when the IO finishes (IO_END)
+    policy->on_block(w->rq, p->fid, runtime);
+    trace_event(TR_IO_START, w->id, p->se.priority, p->job, p->pid, 0);
+  } else {
+    LOG("[SCHEDULER] %d achieved the quantum. Stopping it.\n", p->pid);
+    // stop process
+    preempt_stop(p->pid);
+
+    // charge it and put it back in the queue
+    policy->on_preempt(w->rq, p->fid, runtime);
+    enqueued(p);
+    trace_event(TR_PREEMPT, w->id, p->se.priority, p->job, p->pid, 0);
+  }
+}
+
+
+
+/***** blocking detection *****/
+
+// look in /proc at the running and blocked processes
+// a running process that is sleeping, and barely used the CPU since we last
+// looked, blocked: it stops running as if it reported an IO start
+// a blocked process that is runnable again, or used the CPU, woke up: it
+// joins a queue as if it reported the IO end
+void sample() {
+  ProcSample s;
+  double now = stats_now();
+
+  for(int i=0; i < n_workers; i++) {
+    Worker *w = &workers[i];
+    if(w->running < 0) {
       continue;
     }
-    p = &processes[fid];
-    printf("[SCHEDULER] next process to run:");
-    print_proc(p);
+    Process *p = pt_get(&processes, w->running);
+    if(procwatch_sample(p->pid, &s) < 0) {
+      // it ended, and its pidfd will tell
+      continue;
+    }
+    double elapsed = now - w->sampled_at;
+    if(procwatch_sleeping(&s) && elapsed >= sample_period / 2 &&
+       s.cpu - p->cpu_seen < elapsed / 4) {
+      LOG("[SCHEDULER] %d blocked (state %c)\n", p->pid, s.state);
+      p->blocked = 1;
+      fifo_put(&blocked, p->fid);
+      n_blocked++;
+      stop_running(w, STOP_IO);
+    } else {
+      w->sampled_at = now;
+    }
+    p->cpu_seen = s.cpu;
+  }
 
-    // reset flags before running
-    flag_io = 0;
-    flag_end = 0;
-
-    // run process for quantum time, or until it stops for IO or ends
-    quantum = 1000000 * UT * p->priority;
-    kill(p->pid, SIGUSR2);
-    gettimeofday(&tv1, NULL);
-    do {
-      gettimeofday(&tv2, NULL);
-      runtime = (double) (tv2.tv_usec - tv1.tv_usec) + (double) 1000000*(tv2.tv_sec - tv1.tv_sec);
-    } while((runtime < quantum) && !flag_io && !flag_end);
-
-    if(flag_end) {
-      printf("[SCHEDULER] %d ended. Removing it from queues.\n", p->pid);
-      // if this process ended, we will just ignore it from now on
+  // check each blocked process once
+  for(int n = n_blocked; n > 0; n--) {
+    int fid = fifo_take(&blocked);
+    Process *p = pt_get(&processes, fid);
+    if(procwatch_sample(p->pid, &s) < 0 ||
+       (procwatch_sleeping(&s) && s.cpu == p->cpu_seen)) {
+      fifo_put(&blocked, fid);
       continue;
     }
+    LOG("[SCHEDULER] %d woke up (state %c)\n", p->pid, s.state);
+    p->blocked = 0;
+    n_blocked--;
+    preempt_stop(p->pid);
+    policy->on_wake(workers[p->worker].rq, fid);
+    enqueued(p);
+    trace_event(TR_IO_END, p->worker, p->se.priority, p->job, p->pid, 0);
+  }
+}
+
+
+
+/***** aging *****/
 
-    if(flag_io){
-      printf("[SCHEDULER] %d is running an IO operation. CPU is free.\n", p->pid);
+// move every waiting process to the highest priority level
+// the ones running or doing IO get there when they join a queue again
+// only for policies with levels (mlfq)
+void boost() {
+  LOG("[SCHEDULER] boosting all processes to F1\n");
+  for(int i=0; i < n_workers; i++) {
+    policy->boost(workers[i].rq);
+  }
+  trace_event(TR_BOOST, 0, 0, -1, -1, 0);
+}
+
+
+
+/***** event loop *****/
 
-      // we only increase priority if the process left at least half UT of quantum unused
-      // otherwise, we consider that it used "exactly" the whole quantum, without blowing it
-      if( ((int)runtime) < (quantum-1000000) ) {
-        // increase priority but keep process out of any queue
-        // it will join a queue when the IO finishes (SIGUSR2)
-        if(p->priority == 4) {
-          p->priority = 2;
+// sleep until at least one event arrives and handle all of them
+void restart();
+
+void wait_events() {
+  struct epoll_event events[MAX_EVENTS];
+  struct signalfd_siginfo si;
+  uint64_t count;
+
+  int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+  if(n < 0 && errno == EINTR) {
+    return;
+  }
+  batch_start = stats_now();
+
+  for(int i=0; i < n; i++) {
+    int kind = events[i].data.u64 >> 32;
+    int index = events[i].data.u64 & 0xffffffff;
+    if(kind == EV_SIGNAL) {
+      while(read(signal_fd, &si, sizeof(si)) == sizeof(si)) {
+        if(si.ssi_signo == SIG_IO && si.ssi_int == IO_START) {
+          io_start_handler(&si);
+        } else if(si.ssi_signo == SIG_IO && si.ssi_int == IO_END) {
+          io_end_handler(&si);
+        } else if(si.ssi_signo == SIG_IO) {
+          LOG("[SCHEDULER] unknown IO report %d from %d\n", si.ssi_int, si.ssi_pid);
+        } else if(si.ssi_signo == SIGHUP) {
+          sighup_handler(&si);
+        } else if(si.ssi_signo == SIGUSR1) {
+          sigusr1_handler(&si);
+        } else if(si.ssi_signo == SIGCHLD) {
+          // one of our processes stopped (or ended, which its pidfd tells)
+          preempt_check();
         } else {
-          p->priority = 1;
+          sigterm_handler(&si);
         }
       }
+    } else if(kind == EV_TIMER) {
+      Worker *w = &workers[index];
+      // the timer may have expired just after the process stopped for
+      // another reason, and then there would be nothing to read
+      if(read(w->timer_fd, &count, sizeof(count)) == sizeof(count) && w->running >= 0) {
+        stats_quantum(w->quantum, stats_now() - w->run_start);
+        stop_running(w, STOP_QUANTUM);
+      }
+    } else if(kind == EV_SAMPLE) {
+      read(sample_fd, &count, sizeof(count));
+      sample();
+    } else if(kind == EV_BOOST) {
+      read(boost_fd, &count, sizeof(count));
+      boost();
+    } else if(kind == EV_STOPPED) {
+      preempt_check();
+    } else if(kind == EV_PIDFD) {
+      pidfd_handler(index);
+    } else if(kind == EV_WAKE) {
+      read(wake_fd, &count, sizeof(count));
+      admit();
+      if(restart_asked && atomic_load(&input_stopped)) {
+        restart();
+      }
+    }
+  }
+}
+
+// add fd to the epoll set, waiting for input
+void watch_fd(int fd, int kind, int index) {
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u64 = ((uint64_t) kind << 32) | (uint32_t) index;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+
+/***** input handlers *****/
+
+// the pipe thread reads commands from PIPE_INPUT and from the clients of
+// SOCKET_INPUT, waiting for all of them with its own epoll
+
+#define MAX_CLIENTS 64      // clients connected to SOCKET_INPUT at once
+#define CLIENT_REPLIES (2*MSG_MAX / sizeof(FrameLen)) // frames of a full Reader
+
+// events of input_epoll_fd, with the same tags as epoll_fd
+#define IN_PIPE 1
+#define IN_LISTEN 2
+#define IN_CLIENT 3         // index = slot in clients
+#define IN_STOP 4           // input_stop_fd
+
+// a submitter connected to SOCKET_INPUT
+// we only read its next commands after it took all replies to the last ones
+typedef struct {
+  int fd;
+  Reader reader;
+  Reply replies[CLIENT_REPLIES];  // waiting to be sent
+  int n_replies;
+  int sent;                       // bytes of replies already sent
+} Client;
+
+int input_epoll_fd;
+int input_pipe_fd;                // PIPE_INPUT
+int input_stop_fd;                // written by ask_restart(), ends the pipe thread
+pthread_t t_pipe_input;
+Client *clients[MAX_CLIENTS];     // NULL if the slot is free
+int32_t *next_job;                // id of the next job, kept in STATE_FILE
+
+// create a child process running program_name and send it to the scheduler
+// wake up the scheduler in case it is waiting for a process
+void wake_scheduler() {
+  uint64_t one = 1;
+  write(wake_fd, &one, sizeof(one));
+}
+
+// create a child process running the command prog, as a new job, and send
+// it to the scheduler
+// weight is for its SchedEntity, submitted is when we read it from the pipe
+// returns -1 if the process could not be created
+int spawn(char *prog, int job, int weight, double submitted) {
+  int pid;
+  Admission a;
+
+  // create a parked child process for this command, or take one from the pool
+  if((pid = spawner_get(prog)) < 0) {
+    LOG("[PIPE THREAD] Cannot create a process for %s\n", prog);
+    return -1;
+  }
+
+  // send process data to the scheduler, waiting if it is lagging behind
+  a.pid = pid;
+  a.job = job;
+  a.submitted = submitted;
+  a.weight = weight;
+  strcpy(a.prog, prog);
+  while(!ring_push(&admissions, &a)) {
+    // it may not know there is something to admit yet
+    wake_scheduler();
+    usleep(1000);
+  }
+
+  trace_event(TR_SUBMIT, 0, 0, job, pid, 0);
+  LOG("[PIPE THREAD] Created job %d: %s with pid %d\n", job, prog, pid);
+  return 0;
+}
+
+// create all copies of a command read from the pipe or a client, and
+// describe the result in reply (jobs created get consecutive ids)
+// returns the number of jobs created
+int submit(char *command, Reply *reply) {
+  char *args[CMD_MAX_ARGS+1];
+  char prog[BUF_SIZE] = "";
+  int copies, weight;
+  double submitted = stats_now();
+
+  reply->job = *next_job;
+  reply->copies = 0;
+  if(command_parse(command, args, &copies, &weight) < 0) {
+    LOG("[PIPE THREAD] Invalid command '%s'\n", command);
+    reply->status = REPLY_INVALID;
+    return 0;
+  }
+
+  // the same command, without the number of copies and the weight
+  for(int i=0; args[i] != NULL; i++) {
+    if(i > 0) {
+      strcat(prog, " ");
+    }
+    strcat(prog, args[i]);
+  }
+
+  for(int i=0; i < copies; i++) {
+    if(spawn(prog, *next_job, (long) weight * POLICY_WEIGHT / CMD_WEIGHT, submitted) == 0) {
+      (*next_job)++;
+      reply->copies++;
+    }
+  }
+  reply->status = reply->copies == copies ? REPLY_OK : REPLY_FAILED;
+  return reply->copies;
+}
+
+// add fd to input_epoll_fd, or change what we wait for
+void input_watch(int op, int fd, uint32_t events, int kind, int index) {
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.u64 = ((uint64_t) kind << 32) | (uint32_t) index;
+  epoll_ctl(input_epoll_fd, op, fd, &ev);
+}
+
+// create SOCKET_INPUT, replacing the one of a previous run
+// returns its fd, or -1 on error
+int listen_socket() {
+  struct sockaddr_un addr;
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if(fd < 0) {
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, SOCKET_INPUT, sizeof(addr.sun_path)-1);
+  unlink(SOCKET_INPUT);
+  if(bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// take every pending connection, while there are free slots
+void accept_clients(int listen_fd) {
+  int fd;
+  while((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    int i = 0;
+    while(i < MAX_CLIENTS && clients[i] != NULL) {
+      i++;
+    }
+    if(i == MAX_CLIENTS) {
+      LOG("[PIPE THREAD] Too many clients, closing a new connection\n");
+      close(fd);
+      continue;
+    }
+    clients[i] = malloc(sizeof(Client));
+    clients[i]->fd = fd;
+    clients[i]->reader = reader_create();
+    clients[i]->n_replies = 0;
+    clients[i]->sent = 0;
+    input_watch(EPOLL_CTL_ADD, fd, EPOLLIN, IN_CLIENT, i);
+  }
+}
+
+void close_client(int i) {
+  close(clients[i]->fd);
+  free(clients[i]);
+  clients[i] = NULL;
+}
+
+// send as many pending replies as the socket takes
+// returns 1 if all were sent, 0 if some are left, -1 on error
+int send_replies(Client *c) {
+  int size = c->n_replies * sizeof(Reply);
+  while(c->sent < size) {
+    // MSG_NOSIGNAL: a client that went away must not SIGPIPE us
+    int n = send(c->fd, (char *) c->replies + c->sent, size - c->sent, MSG_NOSIGNAL);
+    if(n < 0) {
+      return errno == EAGAIN ? 0 : -1;
+    }
+    c->sent += n;
+  }
+  c->n_replies = 0;
+  c->sent = 0;
+  return 1;
+}
+
+// the client can take more replies: send them, and read its commands again
+// when all were sent
+void client_writable(int i) {
+  int done = send_replies(clients[i]);
+  if(done < 0) {
+    close_client(i);
+  } else if(done) {
+    input_watch(EPOLL_CTL_MOD, clients[i]->fd, EPOLLIN, IN_CLIENT, i);
+  }
+}
+
+// read commands of the client, submit them and reply
+// returns the number of jobs created
+int client_readable(int i) {
+  Client *c = clients[i];
+  char command[BUF_SIZE];
+  int n = 0;
+
+  int got = reader_fill(&c->reader, c->fd);
+  if(got == 0 || (got < 0 && errno != EAGAIN)) {
+    // it closed the connection
+    close_client(i);
+    return 0;
+  }
+  // a full Reader has at most CLIENT_REPLIES commands, even empty ones
+  int len;
+  while((len = reader_next(&c->reader, command, BUF_SIZE)) >= 0) {
+    n += submit(command, &c->replies[c->n_replies++]);
+  }
+  if(len == -2) {
+    LOG("[PIPE THREAD] frame longer than %d bytes from a client, closing it\n", FRAME_MAX);
+    close_client(i);
+    return n;
+  }
+
+  int done = send_replies(c);
+  if(done < 0) {
+    close_client(i);
+  } else if(!done) {
+    // stop reading until it takes its replies
+    input_watch(EPOLL_CTL_MOD, c->fd, EPOLLOUT, IN_CLIENT, i);
+  }
+  return n;
+}
+
+// read commands from the pipe, which has no replies
+// returns the number of jobs created
+int pipe_readable(int pipe_fd, Reader *reader) {
+  char command[BUF_SIZE];
+  Reply ignored;
+  int n = 0;
+
+  if(reader_fill(reader, pipe_fd) <= 0) {
+    return 0;
+  }
+  // one read may bring many commands
+  int len;
+  while((len = reader_next(reader, command, BUF_SIZE)) >= 0) {
+    n += submit(command, &ignored);
+  }
+  if(len == -2) {
+    // we cannot find where the next frame starts: drop what we have, and
+    // hope the next write() starts with one
+    LOG("[PIPE THREAD] frame longer than %d bytes in %s, dropping %d bytes\n",
+        FRAME_MAX, PIPE_INPUT, reader->len - reader->start);
+    *reader = reader_create();
+  }
+  return n;
+}
+
+// open the named pipe (FIFO), or take the one of the run that restarted
+// us in place, with the commands still in it
+// returns its fd
+int open_pipe() {
+  char *env = getenv(PIPE_FD_ENV);
+  if(env != NULL) {
+    int fd = atoi(env);
+    unsetenv(PIPE_FD_ENV);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+  }
+
+  // we open it for writing too, so that read() never returns 0 (EOF) when
+  // interpreters close it, and we can keep it open forever
+  mkfifo(PIPE_INPUT, 0666);
+  return open(PIPE_INPUT, O_RDWR | O_CLOEXEC);
+}
+
+// this thread handles interpreter input (create new processes)
+// it ends when ask_restart() asks
+void *t_pipe_input_main(void *arg) {
+  struct epoll_event events[MAX_EVENTS];
+  int listen_fd;
+  Reader reader = reader_create();
+
+  LOG("[PIPE THREAD] started thread\n");
+
+  input_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  input_watch(EPOLL_CTL_ADD, input_pipe_fd, EPOLLIN, IN_PIPE, 0);
+  input_watch(EPOLL_CTL_ADD, input_stop_fd, EPOLLIN, IN_STOP, 0);
+  if((listen_fd = listen_socket()) < 0) {
+    LOG("[PIPE THREAD] Cannot create %s, only %s is read\n", SOCKET_INPUT, PIPE_INPUT);
+  } else {
+    input_watch(EPOLL_CTL_ADD, listen_fd, EPOLLIN, IN_LISTEN, 0);
+  }
+
+  while(1) {
+    int n_events = epoll_wait(input_epoll_fd, events, MAX_EVENTS, -1);
+    int n = 0;
+
+    for(int i=0; i < n_events; i++) {
+      int kind = events[i].data.u64 >> 32;
+      int index = events[i].data.u64 & 0xffffffff;
+      if(kind == IN_PIPE) {
+        n += pipe_readable(input_pipe_fd, &reader);
+      } else if(kind == IN_STOP) {
+        // finish the frame we read part of: the rest is in the pipe
+        // already, as batches are written at once, and the next run would
+        // not find the start of its next frame
+        char command[BUF_SIZE];
+        Reply ignored;
+        if(reader_finish(&reader, input_pipe_fd) == 0 &&
+           reader_next(&reader, command, BUF_SIZE) >= 0) {
+          submit(command, &ignored);
+        }
+        atomic_store(&input_stopped, 1);
+        wake_scheduler();
+        return NULL;
+      } else if(kind == IN_LISTEN) {
+        accept_clients(listen_fd);
+      } else if(clients[index] != NULL && clients[index]->n_replies > 0) {
+        // it can take replies, or it failed and sending tells why
+        client_writable(index);
+      } else if(clients[index] != NULL) {
+        n += client_readable(index);
+      }
+    }
+
+    if(n > 0) {
+      wake_scheduler();
+      spawner_refill();
+    }
+  }
+  return NULL;
+}
+
+
+
+/***** warm restart *****/
+
+// processes come back in the order they joined their queues
+int by_seq(const void *a, const void *b) {
+  long seq_a = pt_get(&processes, *(int *) a)->seq;
+  long seq_b = pt_get(&processes, *(int *) b)->seq;
+  return seq_a < seq_b ? -1 : seq_a > seq_b;
+}
+
+// take back the processes that an earlier run left in the process table
+// (see -r): the ones still alive are watched again and come back to the
+// policy in the order they joined their queues
+// the running ones are stopped, and join their queue again
+// children says if we are still their parent (restart in place): then
+// their pids were not reused, since only we reap them
+void restore(int children) {
+  double start = stats_now();
+  int *order = malloc((processes.count + 1) * sizeof(int));
+  int n = 0, ended = 0;
+
+  for(int fid=0; fid < processes.size; fid++) {
+    Process *p = pt_get(&processes, fid);
+    if(p == NULL) {
+      continue;
+    }
+    p->worker %= n_workers;
+    p->stats.queued_level = -1;
+
+    // otherwise, a process that started after we admitted it reused the
+    // pid of ours
+    double started = children ? 0 : procwatch_start(p->pid);
+    if(started < 0 || started > p->admitted_at || (p->pidfd = pidfd_open(p->pid, 0)) < 0) {
+      LOG("[SCHEDULER] %d (job %d) ended while we were away\n", p->pid, p->job);
+      stats_end(&p->stats, p->job, fid, p->pid, p->prog, STATUS_UNKNOWN);
+      preempt_release(p->pid);
+      pt_remove(&processes, fid);
+      ended++;
+      continue;
+    }
+    watch_fd(p->pidfd, EV_PIDFD, fid);
+    order[n++] = fid;
+  }
+  qsort(order, n, sizeof(int), by_seq);
+
+  for(int i=0; i < n; i++) {
+    Process *p = pt_get(&processes, order[i]);
+    int ready = p->queued || p->running;
+    if(p->running) {
+      // nobody would stop it at the end of its quantum
+      preempt_stop(p->pid);
+      p->running = 0;
+    }
+    p->queued = 0;
+    p->blocked = 0;
+    policy->restore(workers[p->worker].rq, p->fid, ready);
+    if(ready) {
+      enqueued(p);
+    } else if(sample_period > 0) {
+      // it is doing IO, and its IO end may go to the earlier run, if that
+      // one was its parent: the sampler will see it
+      p->blocked = 1;
+      fifo_put(&blocked, p->fid);
+      n_blocked++;
+    }
+    LOG("[SCHEDULER] Took back process:");
+    print_proc(p);
+  }
+  free(order);
+
+  LOG("[SCHEDULER] took back %d processes in %.2f ms, %d had ended\n",
+      n, (stats_now() - start) / 1000, ended);
+  print_processes();
+}
+
+// ask the pipe thread to stop between two commands, so that the next run
+// finds the pipe at the start of a command
+// it may still create the processes of the commands it read: we go on
+// scheduling them until it stopped, and then restart()
+void ask_restart() {
+  uint64_t one = 1;
+  if(!restart_asked) {
+    restart_asked = 1;
+    write(input_stop_fd, &one, sizeof(one));
+  }
+}
+
+// stop the pipe thread at once and wait for it, and kill the processes it
+// created that were not admitted yet, before quit() kills the others
+void stop_pipe_thread() {
+  Admission a;
+  uint64_t one = 1;
+
+  write(input_stop_fd, &one, sizeof(one));
+  while(!atomic_load(&input_stopped)) {
+    // it may be waiting for room in admissions
+    while(ring_pop(&admissions, &a)) {
+      reject(a.pid);
+    }
+    usleep(1000);
+  }
+  pthread_join(t_pipe_input, NULL);
+  while(ring_pop(&admissions, &a)) {
+    reject(a.pid);
+  }
+}
+
+// exec the scheduler again, with -r: it takes back our processes, which
+// stay its children
+// called once the pipe thread stopped
+void restart() {
+  char fd_env[32];
+
+  pthread_join(t_pipe_input, NULL);
+  admit();
+
+  write_stats();
+  trace_stop();
+  spawner_kill_pools();
+
+  // the pipe goes on with the commands written to it meanwhile
+  snprintf(fd_env, sizeof(fd_env), "%d", input_pipe_fd);
+  setenv(PIPE_FD_ENV, fd_env, 1);
+  fcntl(input_pipe_fd, F_SETFD, 0);
+  fflush(stdout);
+  execvp(restart_args[0], restart_args);
+
+  printf("[SCHEDULER] Cannot exec %s, the processes are left for %s -r\n",
+         restart_args[0], restart_args[0]);
+  exit(1);
+}
+
+
+
+// parse a comma separated list of quanta, one per level
+// returns the number of levels, or -1 if the list is invalid
+int parse_quanta(char *list, int *quanta) {
+  int n = 0;
+  for(char *tok = strtok(list, ","); tok != NULL; tok = strtok(NULL, ",")) {
+    if(n == RQ_MAX_LEVELS || (quanta[n] = atoi(tok)) <= 0) {
+      return -1;
+    }
+    n++;
+  }
+  return n > 0 ? n : -1;
+}
+
+int main(int argc, char *argv[]) {
+  int opt, n_levels, pin_cpus = 0;
+  int quanta[RQ_MAX_LEVELS];
+  char quanta_list[BUF_SIZE] = DEFAULT_QUANTA;
+  char *sim_file = NULL;
+  char *trace_file = NULL;
+  char ut_env[BUF_SIZE];
+  char tag[sizeof(processes.header->tag)];
+  int restarting = 0;
+  sigset_t mask;
+
+  // restart() runs us again with the same options, and -r
+  restart_args = malloc((argc+2) * sizeof(char *));
+  for(int i=0; i < argc; i++) {
+    restart_args[i] = argv[i];
+    restarting |= strcmp(argv[i], "-r") == 0;
+  }
+  restart_args[argc] = restarting ? NULL : "-r";
+  restart_args[argc+1] = NULL;
+  restarting = 0;
+
+  mlfq_init_ut();
+  while((opt = getopt(argc, argv, "u:q:a:c:p:g:b:f:w:n:t:l:s:P:r")) != -1) {
+    if(opt == 'u') {
+      ut = atoi(optarg);
+    } else if(opt == 'q') {
+      strncpy(quanta_list, optarg, BUF_SIZE-1);
+    } else if(opt == 'a') {
+      if((boost_period = atoi(optarg)) < 0) {
+        printf("Invalid boost period %d\n", boost_period);
+        exit(1);
+      }
+    } else if(opt == 'c') {
+      n_workers = atoi(optarg);
+      pin_cpus = 1;
+    } else if(opt == 'p') {
+      if(preempt_set_mode(optarg) < 0) {
+        printf("Invalid preemption mode '%s': expected signal, stop or freezer\n", optarg);
+        exit(1);
+      }
+    } else if(opt == 'g') {
+      preempt_cgroup = optarg;
+    } else if(opt == 'b') {
+      sample_period = atoi(optarg);
+    } else if(opt == 'f') {
+      if(spawner_set_method(optarg) < 0) {
+        printf("Invalid spawn method '%s': expected fork or spawn\n", optarg);
+        exit(1);
+      }
+    } else if(opt == 'w') {
+      pool_size = atoi(optarg);
+    } else if(opt == 'n') {
+      exit_after = atoi(optarg);
+    } else if(opt == 't') {
+      trace_file = optarg;
+    } else if(opt == 'l') {
+      log_console = atoi(optarg);
+    } else if(opt == 's') {
+      sim_file = optarg;
+    } else if(opt == 'P') {
+      if(policy_set(optarg) < 0) {
+        printf("Invalid policy '%s': expected mlfq, stride or vruntime\n", optarg);
+        exit(1);
+      }
+    } else if(opt == 'r') {
+      restarting = 1;
     } else {
-      printf("[SCHEDULER] %d achieved the quantum. Stopping it.\n", p->pid);
-      // stop process
-      kill(p->pid, SIGUSR1);
-
-      // reduce priority and put process in a lower level queue
-      if(p->priority == 1) {
-        p->priority = 2;
-      } else {
-        p->priority = 4;
+      printf("Usage: %s [-u ut] [-q quanta] [-a boost] [-c workers] [-p mode] [-g cgroup] [-b period] [-f method] [-w pool] [-n jobs] [-t trace] [-l 0|1] [-s workload] [-P policy] [-r]\n", argv[0]);
+      exit(1);
+    }
+  }
+  if((n_levels = parse_quanta(quanta_list, quanta)) < 0) {
+    printf("Invalid quanta '%s': expected up to %d positive integers, like %s\n",
+           quanta_list, RQ_MAX_LEVELS, DEFAULT_QUANTA);
+    exit(1);
+  }
+  if(ut <= 0) {
+    printf("Invalid UT %d\n", ut);
+    exit(1);
+  }
+  for(int i=0; i < n_levels; i++) {
+    // quanta are timed in microsseconds, in an int
+    if(quanta[i] > INT_MAX / ut) {
+      printf("Invalid quantum %d: with UT = %d us, the max is %d\n", quanta[i], ut, INT_MAX / ut);
+      exit(1);
+    }
+  }
+  if(n_workers < 1) {
+    printf("Invalid number of workers %d\n", n_workers);
+    exit(1);
+  }
+  if(pool_size < 0 || pool_size > POOL_MAX) {
+    printf("Invalid pool size %d: expected 0 to %d\n", pool_size, POOL_MAX);
+    exit(1);
+  }
+  if(spawn_method == SPAWN_POSIX && preempt_mode != PREEMPT_SIGNAL) {
+    printf("-f spawn only works with -p signal\n");
+    exit(1);
+  }
+  if(boost_period < 0) {
+    boost_period = mlfq_default_boost(n_levels, quanta);
+  }
+  if(sample_period < 0) {
+    printf("Invalid sampling period %d\n", sample_period);
+    exit(1);
+  }
+  if(preempt_mode == PREEMPT_SIGNAL) {
+    // processes report their IO, and they sleep while waiting for SIGUSR2
+    // to run again
+    sample_period = 0;
+  }
+
+  if(sim_file != NULL) {
+    return simulate(sim_file, n_levels, quanta);
+  }
+
+  LOG("[SCHEDULER] started scheduler with pid %d, UT = %d us, preemption = %s, policy = %s\n",
+         getpid(), ut, preempt_mode_name(), policy->name);
+  if(preempt_init() < 0) {
+    printf("Cannot use cgroup %s for the freezer: it must be a cgroup v2 we can "
+           "write, see -g, or use -p stop\n", preempt_cgroup);
+    exit(1);
+  }
+
+  // children get the same UT and know how they will be stopped
+  snprintf(ut_env, BUF_SIZE, "%d", ut);
+  setenv(UT_ENV, ut_env, 1);
+  setenv(PREEMPT_ENV, preempt_mode_name(), 1);
+
+  // the default timer slack (50us) would make short quanta late
+  prctl(PR_SET_TIMERSLACK, 1);
+
+  // init state, or take it back from the last run
+  // processes of another policy or preemption mode could not come back
+  snprintf(tag, sizeof(tag), "%s %s", policy->name, preempt_mode_name());
+  if(restarting && pt_load(&processes, STATE_FILE) < 0) {
+    printf("Cannot take back the processes in %s, starting without them\n", STATE_FILE);
+    restarting = 0;
+  }
+  if(restarting && strncmp(processes.header->tag, tag, sizeof(tag)) != 0) {
+    printf("The processes in %s are scheduled with '%.*s', not '%s'\n",
+           STATE_FILE, (int) sizeof(tag), processes.header->tag, tag);
+    exit(1);
+  }
+  if(!restarting) {
+    processes = pt_create(STATE_FILE);
+    memcpy(processes.header->tag, tag, sizeof(tag));
+  }
+  next_job = &processes.header->next_job;
+  blocked = fifo_create();
+  admissions = ring_create(ADMIT_RING_SIZE, sizeof(Admission));
+
+  // block SIG_IO -> "IO start or end", SIGHUP -> "write stats",
+  // SIGUSR1 -> "restart", SIGINT/SIGTERM -> "exit" and, with SIGSTOP,
+  // SIGCHLD -> "a process stopped", and read them from signal_fd
+  // this must be done before creating threads, so that they inherit the mask
+  sigemptyset(&mask);
+  sigaddset(&mask, SIG_IO);
+  sigaddset(&mask, SIGHUP);
+  sigaddset(&mask, SIGUSR1);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  if(preempt_mode == PREEMPT_STOP) {
+    sigaddset(&mask, SIGCHLD);
+  }
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+  signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  watch_fd(signal_fd, EV_SIGNAL, 0);
+  watch_fd(wake_fd, EV_WAKE, 0);
+  if(preempt_fd >= 0) {
+    watch_fd(preempt_fd, EV_STOPPED, 0);
+  }
+
+  // init workers, each one with its queues and its quantum timer
+  workers = calloc(n_workers, sizeof(Worker));
+  for(int i=0; i < n_workers; i++) {
+    Worker *w = &workers[i];
+    w->id = i;
+    w->cpu = pin_cpus ? i % sysconf(_SC_NPROCESSORS_ONLN) : -1;
+    w->rq = policy->create(n_levels, quanta, entity_of);
+    w->running = -1;
+    w->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    watch_fd(w->timer_fd, EV_TIMER, i);
+  }
+  stats_init(&processes.header->stats, policy->levels(workers[0].rq), restarting);
+
+  // look for blocked processes every sample_period
+  if(sample_period > 0) {
+    struct itimerspec its;
+    its.it_value.tv_sec = its.it_interval.tv_sec = sample_period / 1000000;
+    its.it_value.tv_nsec = its.it_interval.tv_nsec = (long) (sample_period % 1000000) * 1000;
+    sample_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    timerfd_settime(sample_fd, 0, &its, NULL);
+    watch_fd(sample_fd, EV_SAMPLE, 0);
+  }
+
+  // the drain thread inherits the signal mask too
+  if(trace_file != NULL && trace_start(trace_file, ut, n_workers, restarting) < 0) {
+    printf("Cannot create %s, or it has the trace of a run with another -u or -c\n", trace_file);
+    exit(1);
+  }
+
+  // boost all processes every boost_period
+  if(policy->boost != NULL && boost_period > 0) {
+    struct itimerspec its;
+    long period = (long) boost_period * ut;
+    its.it_value.tv_sec = its.it_interval.tv_sec = period / 1000000;
+    its.it_value.tv_nsec = its.it_interval.tv_nsec = (period % 1000000) * 1000;
+    boost_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    timerfd_settime(boost_fd, 0, &its, NULL);
+    watch_fd(boost_fd, EV_BOOST, 0);
+  }
+
+  if(restarting) {
+    restore(getenv(PIPE_FD_ENV) != NULL);
+  }
+
+  // start thread to handle input from interpreter
+  input_pipe_fd = open_pipe();
+  input_stop_fd = eventfd(0, EFD_CLOEXEC);
+  pthread_create(&t_pipe_input, NULL, t_pipe_input_main, NULL);
+
+  batch_start = stats_now();
+  while(1) {
+    // give a process to every idle worker, then sleep until something happens
+    // workers only steal after all of them had a chance to use their own queues
+    for(int i=0; i < n_workers; i++) {
+      if(workers[i].running < 0) {
+        dispatch(&workers[i], 0);
+      }
+    }
+    for(int i=0; i < n_workers; i++) {
+      if(workers[i].running < 0) {
+        dispatch(&workers[i], 1);
       }
-      enqueue(p);
     }
+    wait_events();
   }
 
   return 0;
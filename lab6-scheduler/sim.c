@@ -0,0 +1,313 @@
+/*
+  Workload files have one job per line:
+
+    <name> <arrival> <burst> [<io> <burst>]...
+
+  All times are in UT, like the arguments of workload.c, and wlgen.c can
+  generate these files too. For example, "workload 5 3 3 3 4" submitted
+  at time 0 is:
+
+    job4 0 5 3 3 3 4
+
+  Lines starting with '#' are ignored.
+
+  The simulation follows the scheduler main loop, with the same policy
+  (see policy.h): the job picked by the policy runs until its quantum ends
+  or until its burst ends. Then it either ends or starts an IO operation.
+  When the IO ends, it joins the queue again. Jobs arriving or finishing
+  IO while another one runs join the queue before the running one is
+  preempted, as happens with IO_END in the scheduler. With mlfq, every
+  boost_period UT all jobs go back to the highest level (see mlfq.h), at
+  the first decision after that time, like the boost timer of the
+  scheduler.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>         // clock_gettime
+
+#include "mlfq.h"
+#include "policy.h"
+#include "sim.h"
+
+#define SIM_MAX_PHASES 64   // max number of bursts and IOs of a job
+#define SIM_NAME_SIZE 64
+
+typedef struct {
+  char name[SIM_NAME_SIZE];
+  double arrival;         // all times are in microsseconds of virtual time
+  double phases[SIM_MAX_PHASES];  // burst, io, burst, io, ..., burst
+  int n_phases;
+  int phase;              // current phase, always a burst when it is ready
+  double left;            // time left in the current burst
+  SchedEntity se;         // state of the policy
+  double first_run;       // -1 until it runs
+  double end;
+  double cpu_time;
+} Job;
+
+// pending event: job 'fid' joins its queue at 'time'
+// this is an arrival if it never ran, or the end of an IO otherwise
+typedef struct {
+  double time;
+  long seq;               // ties are broken by creation order
+  int fid;
+} Event;
+
+// binary min-heap of events
+typedef struct {
+  Event *data;
+  int len;
+  int size;
+  long next_seq;
+} Events;
+
+static int ev_before(Event *a, Event *b) {
+  return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+static void ev_push(Events *h, double time, int fid) {
+  if(h->len == h->size) {
+    h->size = h->size == 0 ? 64 : 2*h->size;
+    h->data = realloc(h->data, h->size * sizeof(Event));
+  }
+  int i = h->len++;
+  h->data[i] = (Event) {time, h->next_seq++, fid};
+  while(i > 0 && ev_before(&h->data[i], &h->data[(i-1)/2])) {
+    Event tmp = h->data[i];
+    h->data[i] = h->data[(i-1)/2];
+    h->data[(i-1)/2] = tmp;
+    i = (i-1)/2;
+  }
+}
+
+static Event ev_pop(Events *h) {
+  Event top = h->data[0];
+  h->data[0] = h->data[--h->len];
+  int i = 0;
+  while(1) {
+    int min = i, l = 2*i+1, r = 2*i+2;
+    if(l < h->len && ev_before(&h->data[l], &h->data[min])) min = l;
+    if(r < h->len && ev_before(&h->data[r], &h->data[min])) min = r;
+    if(min == i) break;
+    Event tmp = h->data[i];
+    h->data[i] = h->data[min];
+    h->data[min] = tmp;
+    i = min;
+  }
+  return top;
+}
+
+static Job *sim_jobs;
+
+static SchedEntity *job_entity(int fid) {
+  return &sim_jobs[fid].se;
+}
+
+// a job joins the queue: it arrived if it never ran, or ended an IO
+static void join(void *rq, int fid) {
+  if(sim_jobs[fid].phase == 0) {
+    policy->admit(rq, fid);
+  } else {
+    policy->on_wake(rq, fid);
+  }
+}
+
+// read the workload file, returns the number of jobs or -1
+static int read_jobs(char *path, Job **jobs) {
+  char line[1024];
+  int n = 0, size = 0;
+  FILE *fp = fopen(path, "r");
+  if(fp == NULL) {
+    return -1;
+  }
+
+  *jobs = NULL;
+  while(fgets(line, sizeof(line), fp)) {
+    char *tok = strtok(line, " \t\n");
+    if(tok == NULL || tok[0] == '#') {
+      continue;
+    }
+    if(n == size) {
+      size = size == 0 ? 64 : 2*size;
+      *jobs = realloc(*jobs, size * sizeof(Job));
+    }
+
+    Job *j = &(*jobs)[n];
+    memset(j, 0, sizeof(Job));
+    strncpy(j->name, tok, SIM_NAME_SIZE-1);
+    if((tok = strtok(NULL, " \t\n")) == NULL) {
+      printf("SKIPPED job '%s' -> no arrival time.\n", j->name);
+      continue;
+    }
+    j->arrival = atof(tok) * ut;
+    while((tok = strtok(NULL, " \t\n")) != NULL && j->n_phases < SIM_MAX_PHASES) {
+      j->phases[j->n_phases++] = atof(tok) * ut;
+    }
+    if(j->n_phases % 2 == 0) {
+      printf("SKIPPED job '%s' -> it must end with a burst.\n", j->name);
+      continue;
+    }
+    j->left = j->phases[0];
+    j->first_run = -1;
+    j->se.weight = POLICY_WEIGHT;
+    n++;
+  }
+
+  fclose(fp);
+  return n;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(double*) a, y = *(double*) b;
+  return x < y ? -1 : x > y;
+}
+
+static void print_metrics(Job *jobs, int n, double makespan, long switches) {
+  double *turnaround = malloc(n * sizeof(double));
+  double sum_turnaround = 0, sum_response = 0, sum_wait = 0, sum_cpu = 0;
+
+  printf("\nJobs (times in UT):\n");
+  for(int i=0; i < n; i++) {
+    Job *j = &jobs[i];
+    double io = 0;
+    for(int k=1; k < j->n_phases; k += 2) {
+      io += j->phases[k];
+    }
+    turnaround[i] = j->end - j->arrival;
+    double response = j->first_run - j->arrival;
+    double wait = turnaround[i] - j->cpu_time - io;
+    printf("  {fid: %d, name: %s, turnaround: %.2f, response: %.2f, wait: %.2f}\n",
+           i, j->name, turnaround[i] / (double) ut,
+           response / (double) ut, wait / (double) ut);
+    sum_turnaround += turnaround[i];
+    sum_response += response;
+    sum_wait += wait;
+    sum_cpu += j->cpu_time;
+  }
+
+  qsort(turnaround, n, sizeof(double), cmp_double);
+  printf("\nSummary (times in UT):\n");
+  printf("  jobs: %d\n", n);
+  printf("  makespan: %.2f\n", makespan / (double) ut);
+  printf("  cpu utilization: %.1f%%\n", makespan > 0 ? 100 * sum_cpu / makespan : 0);
+  printf("  context switches: %ld\n", switches);
+  printf("  mean turnaround: %.2f\n", sum_turnaround / n / (double) ut);
+  // nearest rank: the smallest that is not below 99% of them, as bench.sh
+  printf("  p99 turnaround: %.2f\n", turnaround[(99*n + 99) / 100 - 1] / (double) ut);
+  printf("  mean response: %.2f\n", sum_response / n / (double) ut);
+  printf("  mean wait: %.2f\n", sum_wait / n / (double) ut);
+  free(turnaround);
+}
+
+int simulate(char *path, int n_levels, int *quanta) {
+  Job *jobs;
+  Events events = {NULL, 0, 0, 0};
+  void *rq = policy->create(n_levels, quanta, job_entity);
+  double t = 0;
+  double next_boost = (double) boost_period * ut;
+  long switches = 0, boosts = 0;
+  int ended = 0;
+  struct timespec wall_start, wall_end;
+
+  clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+  int n = read_jobs(path, &jobs);
+  if(n < 0) {
+    printf("Could not read workload '%s'\n", path);
+    return 1;
+  }
+  if(n == 0) {
+    printf("Workload '%s' has no valid jobs\n", path);
+    policy->destroy(rq);
+    return 1;
+  }
+  sim_jobs = jobs;
+  for(int i=0; i < n; i++) {
+    ev_push(&events, jobs[i].arrival, i);
+  }
+
+  printf("Timeline (times in UT):\n");
+  while(ended < n) {
+    // jobs that arrived or finished IO until now join their queues
+    while(events.len > 0 && events.data[0].time <= t) {
+      join(rq, ev_pop(&events).fid);
+    }
+    while(policy->boost != NULL && boost_period > 0 && next_boost <= t) {
+      policy->boost(rq);
+      next_boost += (double) boost_period * ut;
+      boosts++;
+    }
+
+    int fid = policy->pick_next(rq);
+    if(fid < 0) {
+      // CPU idle until the next event
+      t = events.data[0].time;
+      continue;
+    }
+
+    Job *j = &jobs[fid];
+    int level = j->se.priority;
+    int quantum = policy->quantum_for(rq, fid);
+    double start = t;
+    char *what;
+
+    if(j->first_run < 0) {
+      j->first_run = t;
+    }
+    switches++;
+
+    if(j->left > quantum) {
+      // achieved the quantum
+      t += quantum;
+      j->left -= quantum;
+      j->cpu_time += quantum;
+      what = "quantum";
+
+      // events during the quantum are queued before the preempted job
+      while(events.len > 0 && events.data[0].time <= t) {
+        join(rq, ev_pop(&events).fid);
+      }
+      policy->on_preempt(rq, fid, quantum);
+    } else {
+      // finished the burst
+      double runtime = j->left;
+      t += runtime;
+      j->cpu_time += runtime;
+      j->phase++;
+      if(j->phase == j->n_phases) {
+        j->end = t;
+        ended++;
+        policy->on_exit(rq, fid, 0);
+        what = "end";
+      } else {
+        // start IO, it joins a queue again when it finishes
+        policy->on_block(rq, fid, runtime);
+        ev_push(&events, t + j->phases[j->phase], fid);
+        j->phase++;
+        j->left = j->phases[j->phase];
+        what = "io";
+      }
+    }
+
+    printf("  [%8.2f, %8.2f) %-16s F%d -> %-7s -> F%d\n",
+           start / (double) ut, t / (double) ut,
+           j->name, level+1, what, j->se.priority+1);
+  }
+
+  print_metrics(jobs, n, t, switches);
+  if(policy->boost != NULL) {
+    printf("  boosts: %ld\n", boosts);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &wall_end);
+  printf("  simulated in %.3f ms\n",
+         (wall_end.tv_sec - wall_start.tv_sec) * 1000.0 +
+         (wall_end.tv_nsec - wall_start.tv_nsec) / 1000000.0);
+
+  free(jobs);
+  free(events.data);
+  policy->destroy(rq);
+  return 0;
+}
@@ -0,0 +1,9 @@
+/*
+  Simulation mode: runs the multilevel feedback queue policy of mlfq.c
+  against a virtual clock, without creating any process.
+*/
+
+// simulate the workload described in the file with this ready queue setup
+// prints the timeline and the metrics of each job
+// returns 0, or 1 if the file could not be read
+int simulate(char *path, int n_levels, int *quanta);
@@ -0,0 +1,156 @@
+#define _GNU_SOURCE       // environ
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <spawn.h>        // posix_spawn
+#include <sys/wait.h>     // waitpid
+#include "spawner.h"
+#include "preempt.h"
+#include "proctable.h"    // BUF_SIZE
+#include "protocol.h"     // command_split
+
+// parked processes of one command
+typedef struct {
+  char prog[BUF_SIZE];  // the command
+  int submits;          // processes asked for it, to choose who gets a pool
+  int pids[POOL_MAX];
+  int n;                // number of processes in pids
+} Pool;
+
+int spawn_method = SPAWN_FORK;
+int pool_size = 0;
+
+static char *method_names[] = {"fork", "spawn"};
+
+// only the pipe thread uses the pools, except spawner_kill_pools()
+static Pool pools[POOL_PROGS];
+static int n_pools = 0;
+
+int spawner_set_method(char *name) {
+  for(int i=0; i < 2; i++) {
+    if(strcmp(name, method_names[i]) == 0) {
+      spawn_method = i;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+char *spawner_method_name() {
+  return method_names[spawn_method];
+}
+
+// create a new parked process running the command prog
+// returns its pid, or -1
+static int create(char *prog) {
+  int pid;
+  char cmd[BUF_SIZE];
+  char *args[CMD_MAX_ARGS+1];
+
+  strncpy(cmd, prog, BUF_SIZE-1);
+  cmd[BUF_SIZE-1] = '\0';
+  // the number of copies and the weight were taken out already
+  if(command_split(cmd, args) <= 0) {
+    return -1;
+  }
+
+  if(spawn_method == SPAWN_POSIX) {
+    // same signal mask as preempt_child() gives in PREEMPT_SIGNAL
+    posix_spawnattr_t attr;
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR2);
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    int err = posix_spawn(&pid, args[0], NULL, &attr, args, environ);
+    posix_spawnattr_destroy(&attr);
+    return err == 0 ? pid : -1;
+  }
+
+  if((pid=fork()) == 0) {
+    // fix the signals blocked for signal_fd and wait to be resumed
+    preempt_child();
+    execv(args[0], args);
+    _exit(1);
+  }
+  if(pid < 0) {
+    return -1;
+  }
+
+  // the scheduler must only see it when it is stopped
+  // if that fails, it is killed, and reaped by the scheduler once admitted
+  if(preempt_wait_parked(pid) < 0) {
+    kill(pid, SIGKILL);
+  }
+  return pid;
+}
+
+// the pool of prog, or NULL
+// if create, a pool is created for it (replacing the least submitted one
+// if needed)
+static Pool *find_pool(char *prog, int create) {
+  Pool *least = NULL;
+  for(int i=0; i < n_pools; i++) {
+    if(strcmp(pools[i].prog, prog) == 0) {
+      return &pools[i];
+    }
+    if(least == NULL || pools[i].submits < least->submits) {
+      least = &pools[i];
+    }
+  }
+  if(!create) {
+    return NULL;
+  }
+
+  if(n_pools < POOL_PROGS) {
+    least = &pools[n_pools++];
+  } else {
+    // its processes were never admitted, nobody else will reap them
+    while(least->n > 0) {
+      int pid = least->pids[--least->n];
+      kill(pid, SIGKILL);
+      waitpid(pid, NULL, 0);
+    }
+  }
+  memset(least, 0, sizeof(*least));
+  strncpy(least->prog, prog, BUF_SIZE-1);
+  return least;
+}
+
+int spawner_get(char *prog) {
+  if(pool_size == 0) {
+    return create(prog);
+  }
+
+  Pool *pool = find_pool(prog, 1);
+  pool->submits++;
+  if(pool->n > 0) {
+    return pool->pids[--pool->n];
+  }
+  return create(prog);
+}
+
+void spawner_refill() {
+  for(int i=0; i < n_pools; i++) {
+    Pool *pool = &pools[i];
+    while(pool->submits >= POOL_MIN_SUBMITS && pool->n < pool_size) {
+      int pid = create(pool->prog);
+      if(pid < 0) {
+        break;
+      }
+      pool->pids[pool->n++] = pid;
+    }
+  }
+}
+
+void spawner_kill_pools() {
+  for(int i=0; i < n_pools; i++) {
+    for(int j=0; j < pools[i].n; j++) {
+      kill(pools[i].pids[j], SIGKILL);
+      waitpid(pools[i].pids[j], NULL, 0);
+    }
+    pools[i].n = 0;
+  }
+}
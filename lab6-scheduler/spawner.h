@@ -0,0 +1,45 @@
+/*
+  Creation of processes, for the pipe thread.
+
+  SPAWN_FORK forks the scheduler and execs the program in the child.
+  SPAWN_POSIX uses posix_spawn, which does not copy the page tables of the
+  scheduler (glibc runs the child in our memory until it execs), so it is
+  cheaper, but the child cannot stop itself before exec: it only works
+  with PREEMPT_SIGNAL.
+
+  Programs are given as commands: the path and the arguments, separated
+  by spaces (see protocol.h), without the number of copies.
+
+  With a pool size > 0, commands submitted often get that many processes
+  created and parked in advance. Taking one from the pool only costs a
+  lookup, and the pool is refilled later, by spawner_refill().
+*/
+
+#define SPAWN_FORK 0
+#define SPAWN_POSIX 1
+
+#define POOL_PROGS 16       // max number of commands with a pool
+#define POOL_MAX 64         // max size of the pool of each command
+#define POOL_MIN_SUBMITS 2  // processes asked for a command before it gets a pool
+
+extern int spawn_method;
+extern int pool_size;       // processes parked in advance per command, or 0
+
+// set spawn_method from its name
+// returns -1 if there is no such method
+int spawner_set_method(char *name);
+
+// name of spawn_method
+char *spawner_method_name();
+
+// returns a parked process running the command prog, from the pool if there is one
+// there, or -1 if it could not be created
+int spawner_get(char *prog);
+
+// create the processes missing in the pools
+// done after the processes asked for were handed out, to keep it out of
+// their admission latency
+void spawner_refill();
+
+// kill and reap all processes in the pools, which are emptied
+void spawner_kill_pools();
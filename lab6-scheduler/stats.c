@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>       // access
+#include <time.h>         // clock_gettime
+#include <sys/resource.h> // getrusage
+#include "stats.h"
+
+Stats *stats;
+
+double stats_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec * 1000000 + (double) ts.tv_nsec / 1000;
+}
+
+// add the area under the length of the queue until now, and change it
+static void qlen_add(int level, int delta) {
+  double now = stats_now();
+  stats->qlen_area[level] += stats->qlen[level] * (now - stats->qlen_since[level]);
+  stats->qlen_since[level] = now;
+  stats->qlen[level] += delta;
+  if(stats->qlen[level] > stats->qlen_max[level]) {
+    stats->qlen_max[level] = stats->qlen[level];
+  }
+}
+
+void stats_init(Stats *s, int n_levels, int keep) {
+  stats = s;
+  if(keep && stats->n_levels == n_levels) {
+    // the processes that are still queued join the queues again
+    for(int i=0; i < n_levels; i++) {
+      qlen_add(i, -stats->qlen[i]);
+    }
+  } else {
+    memset(stats, 0, sizeof(*stats));
+    stats->start_time = stats_now();
+    stats->n_levels = n_levels;
+    for(int i=0; i < n_levels; i++) {
+      stats->qlen_since[i] = stats->start_time;
+    }
+  }
+
+  if(keep && access(JOBS_FILE, F_OK) == 0) {
+    return;
+  }
+  FILE *f = fopen(JOBS_FILE, "w");
+  if(f == NULL) {
+    return;
+  }
+  fprintf(f, "job,fid,pid,prog,status,turnaround_us,response_us,cpu_us,quanta,preemptions,io_blocks");
+  for(int i=0; i < n_levels; i++) {
+    fprintf(f, ",wait_f%d_us", i+1);
+  }
+  fprintf(f, "\n");
+  fclose(f);
+}
+
+void stats_admit(ProcStats *ps) {
+  memset(ps, 0, sizeof(*ps));
+  ps->submit_time = stats_now();
+  ps->first_run = -1;
+  ps->queued_level = -1;
+  stats->admitted++;
+}
+
+void stats_enqueue(ProcStats *ps, int level) {
+  ps->ready_since = stats_now();
+  ps->queued_level = level;
+  qlen_add(level, 1);
+}
+
+void stats_dequeue(ProcStats *ps) {
+  if(ps->queued_level < 0) {
+    return;
+  }
+  ps->wait_time[ps->queued_level] += stats_now() - ps->ready_since;
+  qlen_add(ps->queued_level, -1);
+  ps->queued_level = -1;
+}
+
+// bucket of the latency histograms
+static int hist_bucket(double us) {
+  int bucket = 0;
+  while(bucket < STATS_HIST-1 && us >= (double) (1L << bucket)) {
+    bucket++;
+  }
+  return bucket;
+}
+
+void stats_admission(double latency) {
+  stats->admission_hist[hist_bucket(latency)]++;
+  stats->n_admission++;
+  stats->admission_sum += latency;
+  if(latency > stats->admission_max) {
+    stats->admission_max = latency;
+  }
+}
+
+void stats_dispatch(ProcStats *ps, double latency) {
+  stats->latency_hist[hist_bucket(latency)]++;
+  stats->context_switches++;
+
+  if(ps->first_run < 0) {
+    ps->first_run = stats_now();
+  }
+  ps->n_quanta++;
+}
+
+void stats_quantum(double requested, double actual) {
+  double jitter = actual - requested;
+  if(jitter < 0) {
+    jitter = 0;
+  }
+  stats->jitter_hist[hist_bucket(jitter)]++;
+  stats->n_jitter++;
+  stats->jitter_sum += jitter;
+  if(jitter > stats->jitter_max) {
+    stats->jitter_max = jitter;
+  }
+}
+
+void stats_stop_timeout() {
+  stats->n_stop_timeout++;
+}
+
+void stats_stop(double latency) {
+  stats->stop_hist[hist_bucket(latency)]++;
+  stats->n_stop++;
+  stats->stop_sum += latency;
+  if(latency > stats->stop_max) {
+    stats->stop_max = latency;
+  }
+}
+
+void stats_run(ProcStats *ps, double runtime, int preempted, int io) {
+  ps->cpu_time += runtime;
+  ps->n_preempt += preempted;
+  ps->n_io += io;
+}
+
+// write s as a CSV field, in quotes: quotes in it are doubled
+static void write_csv_string(FILE *f, char *s) {
+  fputc('"', f);
+  for(; *s != '\0'; s++) {
+    if(*s == '"') {
+      fputc('"', f);
+    }
+    fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+// write s as a JSON string: quotes, backslashes and control characters in
+// it are escaped
+static void write_json_string(FILE *f, char *s) {
+  fputc('"', f);
+  for(; *s != '\0'; s++) {
+    if(*s == '"' || *s == '\\') {
+      fprintf(f, "\\%c", *s);
+    } else if((unsigned char) *s < 0x20) {
+      fprintf(f, "\\u%04x", *s);
+    } else {
+      fputc(*s, f);
+    }
+  }
+  fputc('"', f);
+}
+
+void stats_end(ProcStats *ps, int job, int fid, int pid, char *prog, int status) {
+  double now = stats_now();
+  stats_dequeue(ps);
+  stats->ended++;
+
+  FILE *f = fopen(JOBS_FILE, "a");
+  if(f == NULL) {
+    return;
+  }
+  // the command may have spaces, commas and quotes
+  fprintf(f, "%d,%d,%d,", job, fid, pid);
+  write_csv_string(f, prog);
+  fprintf(f, ",%d,%.0f,%.0f,%.0f,%d,%d,%d", status,
+          now - ps->submit_time,
+          ps->first_run < 0 ? -1 : ps->first_run - ps->submit_time,
+          ps->cpu_time, ps->n_quanta, ps->n_preempt, ps->n_io);
+  for(int i=0; i < stats->n_levels; i++) {
+    fprintf(f, ",%.0f", ps->wait_time[i]);
+  }
+  fprintf(f, "\n");
+  fclose(f);
+}
+
+void stats_write_proc(FILE *f, ProcStats *ps, int job, int fid, int pid, char *prog, int priority) {
+  double now = stats_now();
+  fprintf(f, "{\"job\": %d, \"fid\": %d, \"pid\": %d, \"prog\": ", job, fid, pid);
+  write_json_string(f, prog);
+  fprintf(f, ", \"priority\": %d, "
+             "\"age_us\": %.0f, \"response_us\": %.0f, \"cpu_us\": %.0f, "
+             "\"quanta\": %d, \"preemptions\": %d, \"io_blocks\": %d, \"wait_us\": [",
+          priority, now - ps->submit_time,
+          ps->first_run < 0 ? -1 : ps->first_run - ps->submit_time,
+          ps->cpu_time, ps->n_quanta, ps->n_preempt, ps->n_io);
+  for(int i=0; i < stats->n_levels; i++) {
+    fprintf(f, i == 0 ? "%.0f" : ", %.0f", ps->wait_time[i]);
+  }
+  fprintf(f, "]}");
+}
+
+void stats_write_global(FILE *f) {
+  double now = stats_now();
+  double elapsed = now - stats->start_time;
+
+  // CPU used by the scheduler itself, all threads
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  double cpu = (double) (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 +
+               ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+
+  fprintf(f, "\"uptime_us\": %.0f, \"admitted\": %ld, \"ended\": %ld, "
+             "\"context_switches\": %ld, \"scheduler_cpu_us\": %.0f,\n",
+          elapsed, stats->admitted, stats->ended, stats->context_switches, cpu);
+
+  fprintf(f, "\"dispatch_latency_us_hist\": [");
+  for(int i=0; i < STATS_HIST; i++) {
+    fprintf(f, i == 0 ? "%ld" : ", %ld", stats->latency_hist[i]);
+  }
+  fprintf(f, "],\n");
+
+  fprintf(f, "\"quantum_jitter_us_hist\": [");
+  for(int i=0; i < STATS_HIST; i++) {
+    fprintf(f, i == 0 ? "%ld" : ", %ld", stats->jitter_hist[i]);
+  }
+  fprintf(f, "],\n\"quantum_jitter_us_mean\": %.1f, \"quantum_jitter_us_max\": %.1f,\n",
+          stats->n_jitter > 0 ? stats->jitter_sum / stats->n_jitter : 0, stats->jitter_max);
+
+  fprintf(f, "\"admission_latency_us_hist\": [");
+  for(int i=0; i < STATS_HIST; i++) {
+    fprintf(f, i == 0 ? "%ld" : ", %ld", stats->admission_hist[i]);
+  }
+  fprintf(f, "],\n\"admission_latency_us_mean\": %.1f, \"admission_latency_us_max\": %.1f,\n",
+          stats->n_admission > 0 ? stats->admission_sum / stats->n_admission : 0, stats->admission_max);
+
+  fprintf(f, "\"stop_latency_us_hist\": [");
+  for(int i=0; i < STATS_HIST; i++) {
+    fprintf(f, i == 0 ? "%ld" : ", %ld", stats->stop_hist[i]);
+  }
+  fprintf(f, "],\n\"stop_latency_us_mean\": %.1f, \"stop_latency_us_max\": %.1f, "
+             "\"stop_timeouts\": %ld,\n",
+          stats->n_stop > 0 ? stats->stop_sum / stats->n_stop : 0, stats->stop_max,
+          stats->n_stop_timeout);
+
+  fprintf(f, "\"queues\": [");
+  for(int i=0; i < stats->n_levels; i++) {
+    double area = stats->qlen_area[i] + stats->qlen[i] * (now - stats->qlen_since[i]);
+    fprintf(f, "%s{\"level\": %d, \"length\": %d, \"max_length\": %d, \"mean_length\": %.3f}",
+            i == 0 ? "" : ", ", i, stats->qlen[i], stats->qlen_max[i],
+            elapsed > 0 ? area / elapsed : 0);
+  }
+  fprintf(f, "]");
+}
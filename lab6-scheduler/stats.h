@@ -0,0 +1,116 @@
+/*
+  Accounting of the scheduler. All times are in microsseconds, measured
+  with stats_now().
+
+  The global counters and the counters of live processes are written as
+  JSON to STATS_FILE by stats_write(). Each process that ends is appended
+  as one CSV line to JOBS_FILE by stats_end().
+*/
+
+#include <stdio.h>
+
+#define STATS_FILE "./scheduler.stats.json"
+#define JOBS_FILE "./scheduler.jobs.csv"
+#define STATS_MAX_LEVELS 32   // same as RQ_MAX_LEVELS
+#define STATS_HIST 32         // buckets of the latency histograms
+#define STATUS_UNKNOWN 256    // exit status of a process that was not our child
+
+// counters of one process
+typedef struct {
+  double submit_time;     // when it was admitted
+  double first_run;       // when it ran for the first time, or -1
+  double ready_since;     // when it last joined a queue
+  int queued_level;       // level of the queue it is in, or -1
+  double cpu_time;        // time it was the running process
+  int n_quanta;           // number of times it was dispatched
+  int n_preempt;          // number of times it achieved the quantum
+  int n_io;               // number of IO operations started
+  double wait_time[STATS_MAX_LEVELS]; // time spent in the queue of each level
+} ProcStats;
+
+// global counters
+typedef struct {
+  double start_time;
+  int n_levels;
+  long admitted;
+  long ended;
+  long context_switches;
+  // dispatch latency = time from the end of the previous run (or from the
+  // wake up, if the CPU was idle) to the next process being signaled
+  // bucket 0 counts latencies < 1us, bucket i counts [2^(i-1), 2^i) us
+  long latency_hist[STATS_HIST];
+  // quantum jitter = time a process actually ran when its quantum expired
+  // minus the quantum, in the same buckets as latency_hist
+  long jitter_hist[STATS_HIST];
+  // admission latency = time from reading a program from the pipe to adding
+  // its process to the queues, in the same buckets
+  long admission_hist[STATS_HIST];
+  long n_admission;
+  double admission_sum;
+  double admission_max;
+  long n_jitter;
+  double jitter_sum;
+  double jitter_max;
+  // stop latency = time from asking a process to stop to seeing it stopped
+  // (only with SIGSTOP or the cgroup freezer), in the same buckets
+  long stop_hist[STATS_HIST];
+  long n_stop;
+  double stop_sum;
+  double stop_max;
+  long n_stop_timeout;    // processes that did not stop within PREEMPT_TIMEOUT
+  // queue lengths over time: area under the length of each level
+  int qlen[STATS_MAX_LEVELS];
+  int qlen_max[STATS_MAX_LEVELS];
+  double qlen_area[STATS_MAX_LEVELS];
+  double qlen_since[STATS_MAX_LEVELS];
+} Stats;
+
+extern Stats *stats;   // where stats_init was told to keep them
+
+// microsseconds since some fixed point (CLOCK_MONOTONIC)
+double stats_now();
+
+// keep the global counters in s, reset them, and write the header of
+// JOBS_FILE
+// if keep, s has the counters of an earlier run, which go on from where
+// they were (unless the number of levels changed), and the processes of
+// that run in JOBS_FILE are kept, with the next ones appended
+void stats_init(Stats *s, int n_levels, int keep);
+
+// a new process was admitted
+void stats_admit(ProcStats *ps);
+
+// the process joined the queue of level
+void stats_enqueue(ProcStats *ps, int level);
+
+// the process left its queue
+void stats_dequeue(ProcStats *ps);
+
+// a process submitted latency microsseconds ago reached the scheduler
+void stats_admission(double latency);
+
+// the process is being signaled to run; latency as described in Stats
+void stats_dispatch(ProcStats *ps, double latency);
+
+// the quantum timer expired after actual microsseconds, requested ones
+void stats_quantum(double requested, double actual);
+
+// a process took latency microsseconds to stop after being told to
+void stats_stop(double latency);
+
+// a process did not stop in time after being told to
+void stats_stop_timeout();
+
+// the process stopped running after runtime, because of its quantum (preempted)
+// or because it started an IO operation (io)
+void stats_run(ProcStats *ps, double runtime, int preempted, int io);
+
+// the process ended with status (its exit code, minus the signal that
+// killed it, or STATUS_UNKNOWN): remove it from its queue and append it to JOBS_FILE
+void stats_end(ProcStats *ps, int job, int fid, int pid, char *prog, int status);
+
+// write the counters of one live process as a JSON object
+void stats_write_proc(FILE *f, ProcStats *ps, int job, int fid, int pid, char *prog, int priority);
+
+// write the global counters as the fields of a JSON object
+void stats_write_global(FILE *f);
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "policy.h"
+#include "vtree.h"
+#include "mlfq.h"         // ut
+
+// the pass of a process grows by the CPU time it used, divided by its
+// weight, so the lowest pass is the one furthest behind its share
+// while a process is blocked its vtime is its pass minus the pass of its
+// queue (its lag), which it keeps when it comes back
+
+typedef struct {
+  VTree tree;
+  EntityOf entity;
+  int quantum;          // in microsseconds
+  double vclock;        // pass of the last process picked
+} StrideQueue;
+
+static void *create(int n_levels, int *quanta, EntityOf entity) {
+  StrideQueue *q = malloc(sizeof(StrideQueue));
+  q->tree = vtree_create();
+  q->entity = entity;
+  q->quantum = ut * quanta[0];
+  q->vclock = 0;
+  return q;
+}
+
+static int levels(void *q) {
+  return 1;
+}
+
+static void charge(SchedEntity *se, double runtime) {
+  se->vtime += runtime * POLICY_WEIGHT / se->weight;
+}
+
+static void admit(void *q, int fid) {
+  StrideQueue *sq = q;
+  SchedEntity *se = sq->entity(fid);
+  se->priority = 0;
+  se->vtime = sq->vclock;
+  vtree_insert(&sq->tree, fid, se->vtime);
+}
+
+static int pick_next(void *q) {
+  StrideQueue *sq = q;
+  int fid = vtree_take_first(&sq->tree);
+  if(fid >= 0 && sq->entity(fid)->vtime > sq->vclock) {
+    sq->vclock = sq->entity(fid)->vtime;
+  }
+  return fid;
+}
+
+static int quantum_for(void *q, int fid) {
+  return ((StrideQueue *) q)->quantum;
+}
+
+static void on_preempt(void *q, int fid, double runtime) {
+  StrideQueue *sq = q;
+  SchedEntity *se = sq->entity(fid);
+  charge(se, runtime);
+  vtree_insert(&sq->tree, fid, se->vtime);
+}
+
+static void on_block(void *q, int fid, double runtime) {
+  StrideQueue *sq = q;
+  SchedEntity *se = sq->entity(fid);
+  // it is only charged for what it used of its quantum
+  charge(se, runtime);
+  se->vtime -= sq->vclock;
+}
+
+static void on_wake(void *q, int fid) {
+  StrideQueue *sq = q;
+  SchedEntity *se = sq->entity(fid);
+  se->vtime += sq->vclock;
+  vtree_insert(&sq->tree, fid, se->vtime);
+}
+
+static void on_end(void *q, int fid, int queued) {
+  if(queued) {
+    vtree_remove(&((StrideQueue *) q)->tree, fid);
+  }
+}
+
+static int steal(void *from, void *to) {
+  StrideQueue *src = from, *dst = to;
+  int fid = vtree_take_last(&src->tree);
+  if(fid >= 0) {
+    // keep its lag, in the clock of its new queue
+    src->entity(fid)->vtime += dst->vclock - src->vclock;
+  }
+  return fid;
+}
+
+static void restore(void *q, int fid, int ready) {
+  StrideQueue *sq = q;
+  SchedEntity *se = sq->entity(fid);
+  // a blocked one keeps its lag; the clock starts at the lowest pass ready
+  if(ready) {
+    if(sq->tree.count == 0 || se->vtime < sq->vclock) {
+      sq->vclock = se->vtime;
+    }
+    vtree_insert(&sq->tree, fid, se->vtime);
+  }
+}
+
+static void print(void *q) {
+  printf("Ready (pass) = ");
+  vtree_print(&((StrideQueue *) q)->tree);
+  printf("\n");
+}
+
+static void destroy(void *q) {
+  vtree_free(&((StrideQueue *) q)->tree);
+  free(q);
+}
+
+Policy stride_policy = {
+  "stride", create, levels, admit, pick_next, quantum_for,
+  on_preempt, on_block, on_wake, on_end, steal, restore, NULL, print, destroy
+};
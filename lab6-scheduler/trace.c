@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>       // access, ftruncate
+#include <time.h>         // clock_gettime, nanosleep
+#include <sys/stat.h>     // fstat
+#include <pthread.h>
+#include <stdatomic.h>
+#include "trace.h"
+#include "ring.h"
+
+// one ring per thread, claimed by its first event
+typedef struct {
+  Ring ring;
+  atomic_long dropped;
+} TraceBuf;
+
+static atomic_int tracing;   // set once the buffers are ready
+static TraceBuf bufs[TRACE_MAX_THREADS];
+static atomic_int n_bufs;    // claimed, never more than TRACE_MAX_THREADS
+static _Thread_local TraceBuf *my_buf;
+static _Thread_local int untraced;   // there was no buffer left for this thread
+static uint64_t start_ns;
+
+static FILE *trace_file;
+static pthread_t drain_thread;
+static atomic_int stopping;
+
+static char *kind_names[TR_KINDS] = {
+  "?", "submit", "admit", "dispatch", "preempt", "io_start", "io_end", "exit",
+  "boost"
+};
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// write the records of all rings to the file
+static void drain() {
+  TraceRecord r;
+  int n = atomic_load_explicit(&n_bufs, memory_order_acquire);
+  for(int i=0; i < n && i < TRACE_MAX_THREADS; i++) {
+    while(ring_pop(&bufs[i].ring, &r)) {
+      fwrite(&r, sizeof(r), 1, trace_file);
+    }
+  }
+}
+
+static void *drain_main(void *arg) {
+  struct timespec period = {0, (long) TRACE_PERIOD * 1000};
+  while(!atomic_load(&stopping)) {
+    drain();
+    nanosleep(&period, NULL);
+  }
+  drain();
+  return NULL;
+}
+
+// open the trace in path to add records to it, dropping the last one if
+// it was not written whole
+// returns NULL if path is not a trace of this version, ut and n_workers
+static FILE *trace_append(char *path, TraceHeader *h) {
+  TraceHeader old;
+  struct stat st;
+
+  FILE *f = fopen(path, "r+");
+  if(f == NULL) {
+    return NULL;
+  }
+  if(fread(&old, sizeof(old), 1, f) != 1 || fstat(fileno(f), &st) < 0 ||
+     memcmp(old.magic, h->magic, sizeof(old.magic)) != 0 ||
+     old.version != h->version || old.record_size != h->record_size ||
+     old.ut != h->ut || old.n_workers != h->n_workers) {
+    fclose(f);
+    return NULL;
+  }
+  off_t records = (st.st_size - (off_t) sizeof(old)) / sizeof(TraceRecord);
+  if(ftruncate(fileno(f), sizeof(old) + records * sizeof(TraceRecord)) < 0 ||
+     fseek(f, 0, SEEK_END) < 0) {
+    fclose(f);
+    return NULL;
+  }
+  h->start = old.start;
+  return f;
+}
+
+int trace_start(char *path, int ut, int n_workers, int append) {
+  TraceHeader h;
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, TRACE_MAGIC, sizeof(h.magic));
+  h.version = TRACE_VERSION;
+  h.record_size = sizeof(TraceRecord);
+  h.ut = ut;
+  h.n_workers = n_workers;
+  h.start = now_ns();
+
+  if(append && access(path, F_OK) == 0) {
+    if((trace_file = trace_append(path, &h)) == NULL) {
+      return -1;
+    }
+  } else {
+    if((trace_file = fopen(path, "w")) == NULL) {
+      return -1;
+    }
+    fwrite(&h, sizeof(h), 1, trace_file);
+  }
+
+  for(int i=0; i < TRACE_MAX_THREADS; i++) {
+    bufs[i].ring = ring_create(TRACE_RING_SIZE, sizeof(TraceRecord));
+    atomic_init(&bufs[i].dropped, 0);
+  }
+  atomic_init(&n_bufs, 0);
+  atomic_init(&stopping, 0);
+  start_ns = h.start;
+  atomic_store_explicit(&tracing, 1, memory_order_release);
+  pthread_create(&drain_thread, NULL, drain_main, NULL);
+  return 0;
+}
+
+void trace_event(int kind, int worker, int priority, int job, int pid, int arg) {
+  TraceRecord r;
+
+  if(!atomic_load_explicit(&tracing, memory_order_acquire) || untraced) {
+    return;
+  }
+  if(my_buf == NULL) {
+    int i = atomic_load(&n_bufs);
+    do {
+      if(i == TRACE_MAX_THREADS) {
+        // too many threads: this one is not traced
+        untraced = 1;
+        return;
+      }
+    } while(!atomic_compare_exchange_weak(&n_bufs, &i, i+1));
+    my_buf = &bufs[i];
+  }
+
+  r.time = now_ns() - start_ns;
+  r.kind = kind;
+  r.worker = worker;
+  r.priority = priority;
+  r.job = job;
+  r.pid = pid;
+  r.arg = arg;
+  if(!ring_push(&my_buf->ring, &r)) {
+    atomic_fetch_add_explicit(&my_buf->dropped, 1, memory_order_relaxed);
+  }
+}
+
+long trace_stop() {
+  long dropped = 0;
+
+  if(!atomic_load(&tracing)) {
+    return 0;
+  }
+  atomic_store(&stopping, 1);
+  pthread_join(drain_thread, NULL);
+  fclose(trace_file);
+  atomic_store_explicit(&tracing, 0, memory_order_release);
+
+  for(int i=0; i < TRACE_MAX_THREADS; i++) {
+    dropped += atomic_load(&bufs[i].dropped);
+  }
+  return dropped;
+}
+
+char *trace_kind_name(int kind) {
+  return kind > 0 && kind < TR_KINDS ? kind_names[kind] : kind_names[0];
+}
@@ -0,0 +1,70 @@
+/*
+  Binary trace of the scheduling decisions.
+
+  Each thread that records events gets its own ring (see ring.h), so
+  recording one is a clock read and a copy, without locks or system calls.
+  A drain thread empties the rings into TRACE_FILE every TRACE_PERIOD.
+  When a ring is full its events are dropped and counted, the scheduler is
+  never slowed down by the trace.
+
+  The file is a TraceHeader followed by TraceRecords, in the byte order of
+  the machine. Records of different threads are not in time order. A
+  scheduler restarted with -r appends to the trace of the run before it,
+  with the same time 0.
+  tracedump.c decodes it.
+*/
+
+#include <stdint.h>
+
+#define TRACE_MAGIC "SCHTRACE"
+#define TRACE_VERSION 2
+#define TRACE_RING_SIZE 65536   // records of each thread waiting for the drain
+#define TRACE_MAX_THREADS 4     // threads that record events
+#define TRACE_PERIOD 10000      // how often the rings are drained, in microsseconds
+
+// kinds of events
+#define TR_SUBMIT 1     // the pipe thread created the process of a job
+#define TR_ADMIT 2      // it joined the process table (arg: admission latency, us)
+#define TR_DISPATCH 3   // it started running on a worker (arg: quantum, us)
+#define TR_PREEMPT 4    // it used all its quantum and is ready again
+#define TR_IO_START 5   // it stopped running to do IO
+#define TR_IO_END 6     // it ended its IO and is ready again
+#define TR_EXIT 7       // it ended (arg: exit status, or -signal)
+#define TR_BOOST 8      // all queues were boosted (job and pid are -1)
+#define TR_KINDS 9
+
+typedef struct {
+  char magic[8];        // TRACE_MAGIC, without the '\0'
+  uint32_t version;     // TRACE_VERSION
+  uint32_t record_size; // sizeof(TraceRecord)
+  int32_t ut;           // time unit of the scheduler, in microsseconds
+  int32_t n_workers;
+  uint64_t start;       // CLOCK_MONOTONIC time of the records' time 0, in nanosseconds
+} TraceHeader;
+
+typedef struct {
+  uint64_t time;        // nanosseconds since trace_start
+  uint8_t kind;         // TR_*
+  uint8_t worker;       // worker of the process
+  uint16_t priority;    // queue level of the process, after the event
+  int32_t job;
+  int32_t pid;
+  int32_t arg;          // depends on kind
+} TraceRecord;
+
+// create path, write its header and start the drain thread
+// if append and path has a trace with the same ut and n_workers, the new
+// records are added to it instead
+// returns -1 if the file cannot be created, or has a different trace
+int trace_start(char *path, int ut, int n_workers, int append);
+
+// record an event of the calling thread
+// does nothing if trace_start was not called
+void trace_event(int kind, int worker, int priority, int job, int pid, int arg);
+
+// write all recorded events and close the file
+// returns the number of events dropped because a ring was full
+long trace_stop();
+
+// name of an event kind
+char *trace_kind_name(int kind);
@@ -0,0 +1,245 @@
+/*
+  gcc tracedump.c trace.c ring.c -pthread -o tracedump
+  ./tracedump [-r] [-w 100] [-c us] [-j first-last] scheduler.trace
+
+  Decodes a trace written by scheduler -t (see trace.h) and draws it as a
+  timeline: a row per worker, busy (#) or idle, and a row per job:
+    #  running
+    .  ready, waiting in a queue
+    ~  doing IO
+       not in the scheduler yet, or already ended
+  A column shows the busiest state of its time: a job that ran at any
+  moment of it is drawn running.
+
+  -r: print every record instead, one per line, in time order
+  -w: number of columns of the timeline
+  -c: time of each column, in microsseconds, instead of the whole trace
+      divided by -w
+  -j: only draw these jobs
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>       // getopt
+#include "trace.h"
+
+#define DEFAULT_WIDTH 100
+
+// states of a job, in the order a column chooses them
+#define ST_NONE 0
+#define ST_READY 1
+#define ST_IO 2
+#define ST_RUNNING 3
+
+char state_chars[] = " .~#";
+
+TraceRecord *records;
+int n_records;
+TraceHeader header;
+
+// read the header and all records of the file
+// returns -1 if it is not a trace
+int read_trace(char *path) {
+  FILE *f = fopen(path, "r");
+  int size = 1024;
+
+  if(f == NULL) {
+    return -1;
+  }
+  if(fread(&header, sizeof(header), 1, f) != 1 ||
+     memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+     header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord)) {
+    fclose(f);
+    return -1;
+  }
+
+  records = malloc(size * sizeof(TraceRecord));
+  n_records = 0;
+  while(fread(&records[n_records], sizeof(TraceRecord), 1, f) == 1) {
+    if(++n_records == size) {
+      size *= 2;
+      records = realloc(records, size * sizeof(TraceRecord));
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+// the records of each thread are in time order in the file, sort all of
+// them keeping that order for equal times
+int by_time(const void *a, const void *b) {
+  const TraceRecord *ra = &records[*(int *) a], *rb = &records[*(int *) b];
+  if(ra->time != rb->time) {
+    return ra->time < rb->time ? -1 : 1;
+  }
+  return *(int *) a - *(int *) b;
+}
+
+void sort_records() {
+  int *order = malloc(n_records * sizeof(int));
+  TraceRecord *sorted = malloc(n_records * sizeof(TraceRecord));
+  for(int i=0; i < n_records; i++) {
+    order[i] = i;
+  }
+  qsort(order, n_records, sizeof(int), by_time);
+  for(int i=0; i < n_records; i++) {
+    sorted[i] = records[order[i]];
+  }
+  free(order);
+  free(records);
+  records = sorted;
+}
+
+void print_records() {
+  printf("%12s %-9s %6s %6s %8s %8s %8s\n",
+         "time_us", "event", "worker", "job", "pid", "priority", "arg");
+  for(int i=0; i < n_records; i++) {
+    TraceRecord *r = &records[i];
+    printf("%12.1f %-9s %6d %6d %8d %8d %8d\n", r->time / 1000.0,
+           trace_kind_name(r->kind), r->worker, r->job, r->pid, r->priority, r->arg);
+  }
+}
+
+// paint state over the columns of row covering [from, to)
+void paint(char *row, int width, double column, uint64_t from, uint64_t to, int state) {
+  if(state == ST_NONE || to <= from) {
+    return;
+  }
+  int first = from / column;
+  int last = (to - 1) / column;
+  for(int c = first; c <= last && c < width; c++) {
+    if(row[c] < state) {
+      row[c] = state;
+    }
+  }
+}
+
+void print_row(char *label, char *row, int width) {
+  printf("%-10s|", label);
+  for(int c=0; c < width; c++) {
+    putchar(state_chars[(int) row[c]]);
+  }
+  printf("|\n");
+}
+
+// draw the timeline of workers and of jobs first..last
+void print_timeline(int width, double column, int first, int last) {
+  uint64_t end = records[n_records-1].time + 1;
+  int max_job = 0;
+  char label[32];
+
+  for(int i=0; i < n_records; i++) {
+    if(records[i].job > max_job) {
+      max_job = records[i].job;
+    }
+  }
+  if(last < 0 || last > max_job) {
+    last = max_job;
+  }
+  if(column <= 0) {
+    column = (double) end / width;
+  }
+
+  // state of each job since when, and the worker it runs on
+  int *state = calloc(max_job+1, sizeof(int));
+  uint64_t *since = calloc(max_job+1, sizeof(uint64_t));
+  int *worker = calloc(max_job+1, sizeof(int));
+  char *rows = calloc((size_t) (max_job+1) * width, 1);
+  char *worker_rows = calloc((size_t) (header.n_workers > 0 ? header.n_workers : 1) * width, 1);
+
+  for(int i=0; i < n_records; i++) {
+    TraceRecord *r = &records[i];
+    int job = r->job;
+    int next;
+    if(job < 0) {
+      continue;
+    }
+    if(r->kind == TR_ADMIT || r->kind == TR_PREEMPT || r->kind == TR_IO_END) {
+      next = ST_READY;
+    } else if(r->kind == TR_DISPATCH) {
+      next = ST_RUNNING;
+      worker[job] = r->worker;
+    } else if(r->kind == TR_IO_START) {
+      next = ST_IO;
+    } else if(r->kind == TR_EXIT) {
+      next = ST_NONE;
+    } else {
+      continue;
+    }
+    paint(&rows[(size_t) job * width], width, column, since[job], r->time, state[job]);
+    if(state[job] == ST_RUNNING && worker[job] < header.n_workers) {
+      paint(&worker_rows[worker[job] * width], width, column, since[job], r->time, ST_RUNNING);
+    }
+    state[job] = next;
+    since[job] = r->time;
+  }
+  // jobs that did not end yet
+  for(int job=0; job <= max_job; job++) {
+    paint(&rows[(size_t) job * width], width, column, since[job], end, state[job]);
+    if(state[job] == ST_RUNNING && worker[job] < header.n_workers) {
+      paint(&worker_rows[worker[job] * width], width, column, since[job], end, ST_RUNNING);
+    }
+  }
+
+  printf("UT = %d us, %d records, %.3f s, %.0f us per column\n",
+         header.ut, n_records, end / 1e9, column / 1000);
+  for(int w=0; w < header.n_workers; w++) {
+    snprintf(label, sizeof(label), "worker %d", w);
+    print_row(label, &worker_rows[w * width], width);
+  }
+  for(int job = first; job <= last; job++) {
+    snprintf(label, sizeof(label), "job %d", job);
+    print_row(label, &rows[(size_t) job * width], width);
+  }
+
+  free(state);
+  free(since);
+  free(worker);
+  free(rows);
+  free(worker_rows);
+}
+
+int main(int argc, char *argv[]) {
+  int opt, raw = 0, width = DEFAULT_WIDTH, first = 0, last = -1;
+  double column = 0;
+
+  while((opt = getopt(argc, argv, "rw:c:j:")) != -1) {
+    if(opt == 'r') {
+      raw = 1;
+    } else if(opt == 'w') {
+      width = atoi(optarg);
+    } else if(opt == 'c') {
+      // in nanosseconds from now on, like the records
+      column = atof(optarg) * 1000;
+    } else if(opt == 'j') {
+      if(sscanf(optarg, "%d-%d", &first, &last) != 2) {
+        first = last = atoi(optarg);
+      }
+    } else {
+      printf("Usage: %s [-r] [-w columns] [-c us] [-j first-last] trace\n", argv[0]);
+      exit(1);
+    }
+  }
+  if(optind != argc-1 || width <= 0) {
+    printf("Usage: %s [-r] [-w columns] [-c us] [-j first-last] trace\n", argv[0]);
+    exit(1);
+  }
+
+  if(read_trace(argv[optind]) < 0) {
+    printf("%s is not a scheduler trace\n", argv[optind]);
+    exit(1);
+  }
+  if(n_records == 0) {
+    printf("%s has no records\n", argv[optind]);
+    return 0;
+  }
+  sort_records();
+
+  if(raw) {
+    print_records();
+  } else {
+    print_timeline(width, column, first, last);
+  }
+  return 0;
+}
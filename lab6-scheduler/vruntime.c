@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "policy.h"
+#include "vtree.h"
+#include "mlfq.h"         // ut
+
+#define VR_LATENCY 6      // UT in which every ready process should run once
+#define VR_MIN_SLICE 0.5  // shortest slice, in UT, however many are ready
+
+// the virtual runtime of a process grows by the CPU time it used, divided
+// by its weight
+
+typedef struct {
+  VTree tree;
+  EntityOf entity;
+  double min_vruntime;  // never decreases, new processes start there
+  long ready_weight;    // sum of the weights of the processes in tree
+} VrQueue;
+
+static void *create(int n_levels, int *quanta, EntityOf entity) {
+  VrQueue *q = malloc(sizeof(VrQueue));
+  q->tree = vtree_create();
+  q->entity = entity;
+  q->min_vruntime = 0;
+  q->ready_weight = 0;
+  return q;
+}
+
+static int levels(void *q) {
+  return 1;
+}
+
+static void insert(VrQueue *q, int fid) {
+  SchedEntity *se = q->entity(fid);
+  vtree_insert(&q->tree, fid, se->vtime);
+  q->ready_weight += se->weight;
+}
+
+static void admit(void *q, int fid) {
+  VrQueue *vq = q;
+  SchedEntity *se = vq->entity(fid);
+  se->priority = 0;
+  se->vtime = vq->min_vruntime;
+  insert(vq, fid);
+}
+
+static int pick_next(void *q) {
+  VrQueue *vq = q;
+  int fid = vtree_take_first(&vq->tree);
+  if(fid >= 0) {
+    SchedEntity *se = vq->entity(fid);
+    vq->ready_weight -= se->weight;
+    if(se->vtime > vq->min_vruntime) {
+      vq->min_vruntime = se->vtime;
+    }
+  }
+  return fid;
+}
+
+static int quantum_for(void *q, int fid) {
+  VrQueue *vq = q;
+  SchedEntity *se = vq->entity(fid);
+  // its share of VR_LATENCY among itself and the ones waiting
+  double slice = (double) VR_LATENCY * ut * se->weight / (vq->ready_weight + se->weight);
+  if(slice < VR_MIN_SLICE * ut) {
+    slice = VR_MIN_SLICE * ut;
+  }
+  return (int) slice;
+}
+
+static void on_preempt(void *q, int fid, double runtime) {
+  VrQueue *vq = q;
+  SchedEntity *se = vq->entity(fid);
+  se->vtime += runtime * POLICY_WEIGHT / se->weight;
+  insert(vq, fid);
+}
+
+static void on_block(void *q, int fid, double runtime) {
+  SchedEntity *se = ((VrQueue *) q)->entity(fid);
+  se->vtime += runtime * POLICY_WEIGHT / se->weight;
+}
+
+static void on_wake(void *q, int fid) {
+  VrQueue *vq = q;
+  SchedEntity *se = vq->entity(fid);
+  // it did not use the CPU while it slept, but it only gets some credit for it
+  double floor = vq->min_vruntime - (double) VR_LATENCY * ut / 2;
+  if(se->vtime < floor) {
+    se->vtime = floor;
+  }
+  insert(vq, fid);
+}
+
+static void on_end(void *q, int fid, int queued) {
+  VrQueue *vq = q;
+  if(queued && vtree_remove(&vq->tree, fid)) {
+    vq->ready_weight -= vq->entity(fid)->weight;
+  }
+}
+
+static int steal(void *from, void *to) {
+  VrQueue *src = from, *dst = to;
+  int fid = vtree_take_last(&src->tree);
+  if(fid >= 0) {
+    SchedEntity *se = src->entity(fid);
+    src->ready_weight -= se->weight;
+    // keep its distance to min_vruntime, in its new queue
+    se->vtime += dst->min_vruntime - src->min_vruntime;
+  }
+  return fid;
+}
+
+static void restore(void *q, int fid, int ready) {
+  VrQueue *vq = q;
+  SchedEntity *se = vq->entity(fid);
+  // min_vruntime starts at the lowest virtual runtime that came back, so
+  // that new processes do not start far behind the old ones
+  if((vq->tree.count == 0 && vq->min_vruntime == 0) || se->vtime < vq->min_vruntime) {
+    vq->min_vruntime = se->vtime;
+  }
+  if(ready) {
+    insert(vq, fid);
+  }
+}
+
+static void print(void *q) {
+  printf("Ready (vruntime) = ");
+  vtree_print(&((VrQueue *) q)->tree);
+  printf("\n");
+}
+
+static void destroy(void *q) {
+  vtree_free(&((VrQueue *) q)->tree);
+  free(q);
+}
+
+Policy vruntime_policy = {
+  "vruntime", create, levels, admit, pick_next, quantum_for,
+  on_preempt, on_block, on_wake, on_end, steal, restore, NULL, print, destroy
+};
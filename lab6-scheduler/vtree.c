@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "vtree.h"
+
+#define VTREE_MIN_SIZE 64
+
+// xorshift, enough for the priorities of a treap
+static unsigned int random_prio() {
+  static unsigned int x = 2463534242u;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+VTree vtree_create() {
+  return (VTree) {NULL, NULL, NULL, NULL, 0, -1, 0};
+}
+
+// make room for fid in the arrays
+static void vtree_reserve(VTree *t, int fid) {
+  if(fid < t->size) {
+    return;
+  }
+  int size = t->size == 0 ? VTREE_MIN_SIZE : t->size;
+  while(size <= fid) {
+    size *= 2;
+  }
+  t->left = realloc(t->left, size * sizeof(int));
+  t->right = realloc(t->right, size * sizeof(int));
+  t->prio = realloc(t->prio, size * sizeof(unsigned int));
+  t->key = realloc(t->key, size * sizeof(double));
+  assert(t->left != NULL && t->right != NULL && t->prio != NULL && t->key != NULL);
+  t->size = size;
+}
+
+// does a go before b?
+static int before(VTree *t, int a, int b) {
+  return t->key[a] < t->key[b] || (t->key[a] == t->key[b] && a < b);
+}
+
+// join two trees, where all fids of a go before all fids of b
+static int merge(VTree *t, int a, int b) {
+  if(a < 0) {
+    return b;
+  }
+  if(b < 0) {
+    return a;
+  }
+  if(t->prio[a] > t->prio[b]) {
+    t->right[a] = merge(t, t->right[a], b);
+    return a;
+  }
+  t->left[b] = merge(t, a, t->left[b]);
+  return b;
+}
+
+// split the tree at node into the fids before fid (*l) and the others (*r)
+static void split(VTree *t, int node, int fid, int *l, int *r) {
+  if(node < 0) {
+    *l = *r = -1;
+  } else if(before(t, node, fid)) {
+    split(t, t->right[node], fid, &t->right[node], r);
+    *l = node;
+  } else {
+    split(t, t->left[node], fid, l, &t->left[node]);
+    *r = node;
+  }
+}
+
+void vtree_insert(VTree *t, int fid, double key) {
+  int l, r;
+  vtree_reserve(t, fid);
+  t->key[fid] = key;
+  t->prio[fid] = random_prio();
+  t->left[fid] = t->right[fid] = -1;
+  split(t, t->root, fid, &l, &r);
+  t->root = merge(t, merge(t, l, fid), r);
+  t->count++;
+}
+
+int vtree_take_first(VTree *t) {
+  if(t->root < 0) {
+    return -1;
+  }
+  // the leftmost node is replaced by its right subtree
+  int *link = &t->root;
+  while(t->left[*link] >= 0) {
+    link = &t->left[*link];
+  }
+  int fid = *link;
+  *link = t->right[fid];
+  t->count--;
+  return fid;
+}
+
+int vtree_take_last(VTree *t) {
+  if(t->root < 0) {
+    return -1;
+  }
+  int *link = &t->root;
+  while(t->right[*link] >= 0) {
+    link = &t->right[*link];
+  }
+  int fid = *link;
+  *link = t->left[fid];
+  t->count--;
+  return fid;
+}
+
+int vtree_remove(VTree *t, int fid) {
+  if(fid >= t->size) {
+    return 0;
+  }
+  // search by the key it was inserted with
+  int *link = &t->root;
+  while(*link >= 0 && *link != fid) {
+    link = before(t, fid, *link) ? &t->left[*link] : &t->right[*link];
+  }
+  if(*link < 0) {
+    return 0;
+  }
+  *link = merge(t, t->left[fid], t->right[fid]);
+  t->count--;
+  return 1;
+}
+
+static void print_node(VTree *t, int node, int *first) {
+  if(node < 0) {
+    return;
+  }
+  print_node(t, t->left[node], first);
+  printf(*first ? "%d (%.0f)" : ", %d (%.0f)", node, t->key[node]);
+  *first = 0;
+  print_node(t, t->right[node], first);
+}
+
+void vtree_print(VTree *t) {
+  int first = 1;
+  if(t->root < 0) {
+    printf("[empty]");
+    return;
+  }
+  printf("[");
+  print_node(t, t->root, &first);
+  printf("]");
+}
+
+void vtree_free(VTree *t) {
+  free(t->left);
+  free(t->right);
+  free(t->prio);
+  free(t->key);
+  *t = vtree_create();
+}
@@ -0,0 +1,41 @@
+/*
+  Ready processes ordered by a virtual time (the pass of stride, the
+  virtual runtime of vruntime), lowest first. Ties go to the lowest fid.
+
+  It is a treap: a binary search tree by (key, fid) that is also a heap by
+  a random priority of each node, so it stays balanced on average and
+  every operation takes O(log n). Nodes are indexed by fid, in arrays that
+  grow with the highest fid, so inserting never allocates after warming up.
+*/
+
+typedef struct {
+  int *left, *right;    // children of each fid, or -1
+  unsigned int *prio;   // heap priority of each fid
+  double *key;          // virtual time of each fid in the tree
+  int size;             // fids with room in the arrays
+  int root;             // fid at the root, or -1
+  int count;            // number of fids in the tree
+} VTree;
+
+// returns an empty tree
+VTree vtree_create();
+
+// add fid with this key, fid must not be in the tree
+void vtree_insert(VTree *t, int fid, double key);
+
+// remove and return the fid with the lowest key
+// returns -1 if the tree is empty
+int vtree_take_first(VTree *t);
+
+// remove and return the fid with the highest key
+// returns -1 if the tree is empty
+int vtree_take_last(VTree *t);
+
+// remove fid from the tree
+// returns 0 if it was not there
+int vtree_remove(VTree *t, int fid);
+
+// print the fids in order, with their keys
+void vtree_print(VTree *t);
+
+void vtree_free(VTree *t);
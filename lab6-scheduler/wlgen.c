@@ -0,0 +1,157 @@
+/*
+  gcc wlgen.c -lm -o wlgen
+  ./wlgen [-n 100] [-m all] [-k 1] [-r 1] [-s] [-a 0] > input.txt
+
+  Generates jobs for workload.c, each with its own burst and IO pattern,
+  as interpreter commands (exec workload ...), or with -s as a workload
+  file for the simulation mode of the scheduler (see sim.c).
+
+  -n: number of jobs
+  -m: kind of jobs:
+      cpu      few long bursts, short IOs
+      io       many short bursts, long IOs
+      bimodal  each burst is either very short or long
+      heavy    bursts with a heavy tailed (Pareto) distribution: most are
+               short, a few are very long
+      all      each job is of one of the kinds above, at random
+  -k: multiply all durations by this
+  -r: seed of the random numbers, the same seed gives the same jobs
+  -s: write a simulation workload instead of commands
+  -a: with -s, mean time between arrivals, in UT (0: all arrive at 0)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>       // getopt
+#include <math.h>         // log, pow, round
+
+#define MAX_PHASES 31     // bursts and IOs of a job, so that a command fits in CMD_MAX_ARGS
+#define MIN_DURATION 0.1  // in UT
+#define MAX_DURATION 50   // in UT, for the heavy tail
+
+#define KIND_CPU 0
+#define KIND_IO 1
+#define KIND_BIMODAL 2
+#define KIND_HEAVY 3
+#define KIND_ALL 4
+
+char *kind_names[] = {"cpu", "io", "bimodal", "heavy", "all"};
+
+double scale = 1;
+
+// uniform in [0, 1)
+double uniform() {
+  return drand48();
+}
+
+// integer uniform in [min, max]
+int between(int min, int max) {
+  return min + (int) (uniform() * (max - min + 1));
+}
+
+// exponential with this mean
+double exponential(double mean) {
+  return -mean * log(1 - uniform());
+}
+
+// Pareto with this minimum and shape (smaller shape = heavier tail)
+double pareto(double min, double shape) {
+  return min / pow(1 - uniform(), 1 / shape);
+}
+
+// round to one decimal, scale and keep within the limits
+double duration(double d) {
+  d *= scale;
+  if(d > MAX_DURATION * scale) {
+    d = MAX_DURATION * scale;
+  }
+  d = round(d * 10) / 10;
+  return d < MIN_DURATION ? MIN_DURATION : d;
+}
+
+// fill phases with a job of this kind
+// returns the number of phases (bursts and IOs), always odd
+int make_job(int kind, double *phases) {
+  int n_bursts;
+  double io_mean;
+
+  if(kind == KIND_CPU) {
+    n_bursts = between(1, 3);
+    io_mean = 1;
+  } else if(kind == KIND_IO) {
+    n_bursts = between(4, (MAX_PHASES+1)/2);
+    io_mean = 3;
+  } else {
+    n_bursts = between(2, 8);
+    io_mean = 2;
+  }
+
+  for(int i=0; i < n_bursts; i++) {
+    double burst;
+    if(kind == KIND_CPU) {
+      burst = exponential(6);
+    } else if(kind == KIND_IO) {
+      burst = exponential(0.4);
+    } else if(kind == KIND_BIMODAL) {
+      burst = uniform() < 0.5 ? exponential(0.3) : exponential(8);
+    } else {
+      burst = pareto(0.3, 1.5);
+    }
+    phases[2*i] = duration(burst);
+    if(i < n_bursts-1) {
+      phases[2*i+1] = duration(exponential(io_mean));
+    }
+  }
+  return 2*n_bursts - 1;
+}
+
+int main(int argc, char *argv[]) {
+  int opt, n_jobs = 100, kind = KIND_ALL, sim = 0;
+  long seed = 1;
+  double interarrival = 0, arrival = 0;
+  double phases[MAX_PHASES];
+
+  while((opt = getopt(argc, argv, "n:m:k:r:sa:")) != -1) {
+    if(opt == 'n') {
+      n_jobs = atoi(optarg);
+    } else if(opt == 'm') {
+      for(kind = 0; kind <= KIND_ALL && strcmp(optarg, kind_names[kind]) != 0; kind++);
+    } else if(opt == 'k') {
+      scale = atof(optarg);
+    } else if(opt == 'r') {
+      seed = atol(optarg);
+    } else if(opt == 's') {
+      sim = 1;
+    } else if(opt == 'a') {
+      interarrival = atof(optarg);
+    } else {
+      kind = -1;
+    }
+  }
+  if(kind < 0 || kind > KIND_ALL || n_jobs < 0 || scale <= 0 || interarrival < 0) {
+    printf("Usage: %s [-n jobs] [-m cpu|io|bimodal|heavy|all] [-k scale] [-r seed] [-s] [-a interarrival]\n",
+           argv[0]);
+    exit(1);
+  }
+  srand48(seed);
+
+  if(sim) {
+    printf("# wlgen -n %d -m %s -k %g -r %ld -a %g\n", n_jobs, kind_names[kind], scale, seed, interarrival);
+    printf("# <name> <arrival> <burst> [<io> <burst>]...   (times in UT)\n");
+  }
+  for(int i=0; i < n_jobs; i++) {
+    int n = make_job(kind == KIND_ALL ? between(0, KIND_ALL-1) : kind, phases);
+    if(sim) {
+      printf("job%d %g", i, round(arrival * 10) / 10);
+      arrival += interarrival > 0 ? exponential(interarrival) : 0;
+    } else {
+      printf("exec workload");
+    }
+    for(int j=0; j < n; j++) {
+      printf(" %g", phases[j]);
+    }
+    printf("\n");
+  }
+  return 0;
+}
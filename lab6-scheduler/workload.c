@@ -0,0 +1,220 @@
+/*
+  gcc workload.c -o workload
+  ./workload <burst> [<io> <burst>]...
+  ./workload -f <spec-file>
+
+  Runs CPU bursts and IO operations, one after the other, with the given
+  durations in UT (they may have decimals). For example, 5 UT burst, 3 UT
+  IO, 4 UT burst:
+    ./workload 5 3 4
+  A spec file has the same numbers, separated by spaces or new lines, and
+  may have comments from '#' to the end of the line. wlgen.c generates
+  commands with many different patterns.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>         // clock_gettime, clock_nanosleep
+#include <string.h>       // strcmp
+#include <errno.h>        // errno, EAGAIN
+#include <sched.h>        // sched_yield
+#include "jobenv.h"       // UT_ENV, PREEMPT_ENV, SIG_IO
+
+#define BUF_SIZE 255          // max size of string buffers
+#define MAX_PHASES 1024       // max number of bursts and IOs
+
+int ut = DEFAULT_UT;
+
+// 1 if the scheduler stops us with SIGUSR1 and waits for us to stop
+// 0 if it stops us itself (SIGSTOP or cgroup freezer), without telling us
+int cooperative = 1;
+
+int mypid;
+
+// messages of the signal handlers, which cannot use printf: a signal that
+// arrives while printf allocates its buffer would deadlock in malloc
+char stop_msg[BUF_SIZE], run_msg[BUF_SIZE];
+
+// microsseconds since some fixed point, of this clock
+double now(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (double) ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+// wait until the scheduler sends a SIGUSR2
+// SIGUSR2 is kept blocked and only accepted here, so that a SIGUSR2 sent
+// before we get here is not lost
+void wait_for_run() {
+  sigset_t mask;
+  if(!cooperative) {
+    // the scheduler resumes us itself
+    return;
+  }
+  sigprocmask(SIG_BLOCK, NULL, &mask);
+  sigdelset(&mask, SIGUSR2);
+  sigsuspend(&mask);
+}
+
+// SIGUSR1 is our SIGSTOP
+void sigusr1_handler() {
+  write(STDOUT_FILENO, stop_msg, strlen(stop_msg));
+  wait_for_run();
+}
+
+// SIGUSR2 is our SIGCONT
+void sigusr2_handler() {
+  write(STDOUT_FILENO, run_msg, strlen(run_msg));
+}
+
+// tell the scheduler that we start or end an IO
+// the signal is queued, even if many processes send it at the same time
+void report_io(int event) {
+  union sigval value;
+  value.sival_int = event;
+  // the queue of pending signals of the user may be full for a moment
+  while(sigqueue(getppid(), SIG_IO, value) < 0 && errno == EAGAIN) {
+    sched_yield();
+  }
+}
+
+// use the CPU for burst_size UT
+// progress is our CPU time, so time stopped by the scheduler, or running
+// other processes, does not count, whatever the way we were stopped
+void run_burst(double burst_size) {
+  double runtime = 0;   // in microsseconds
+  int runtime_ut = 0;
+  double max_time = (double) ut*burst_size;
+  double start = now(CLOCK_THREAD_CPUTIME_ID);
+
+  printf("[pid %d] started burst\n", mypid);
+  do {
+    runtime = now(CLOCK_THREAD_CPUTIME_ID) - start;
+
+    // log each UT
+    if( runtime > (double) ut*(runtime_ut+1) ) {
+      runtime_ut++;
+      printf("[pid %d] completed %d UT of BURST.\n",
+              mypid, runtime_ut);
+    }
+  } while(runtime < max_time);
+  printf("[pid %d] finished burst\n", mypid);
+}
+
+// sleep for io_time UT, like a real IO operation would
+void run_IO(double io_time) {
+  struct timespec wake;
+  int runtime_ut = 0;
+  double start = now(CLOCK_MONOTONIC);
+  double end = start + (double) ut*io_time;
+
+  // warn scheduler about IO start
+  report_io(IO_START);
+
+  printf("[pid %d] started IO\n", mypid);
+  while(now(CLOCK_MONOTONIC) < end) {
+    // sleep until the end of the next UT, or of the IO, to log each UT
+    double until = start + (double) ut*(runtime_ut+1);
+    if(until > end) {
+      until = end;
+    }
+    wake.tv_sec = (time_t) (until / 1000000);
+    wake.tv_nsec = (long) ((until - (double) wake.tv_sec*1000000) * 1000);
+    if(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) != 0) {
+      // interrupted by a signal: sleep again
+      continue;
+    }
+    if(until < end) {
+      runtime_ut++;
+      printf("[pid %d] completed %d UT of IO OPERATION.\n",
+              mypid, runtime_ut);
+    }
+  }
+  printf("[pid %d] finished IO\n", mypid);
+
+  // warn scheduler about IO end and wait to be re-scheduled
+  report_io(IO_END);
+  wait_for_run();
+}
+
+// read the durations of a spec file to phases
+// returns the number of durations, or -1 if the file is invalid
+int read_spec(char *path, double *phases) {
+  char line[BUF_SIZE];
+  int n = 0;
+  FILE *f = fopen(path, "r");
+  if(f == NULL) {
+    return -1;
+  }
+  while(fgets(line, BUF_SIZE, f)) {
+    strtok(line, "#");
+    for(char *tok = strtok(line, " \t\n"); tok != NULL; tok = strtok(NULL, " \t\n")) {
+      if(n == MAX_PHASES) {
+        fclose(f);
+        return -1;
+      }
+      phases[n++] = atof(tok);
+    }
+  }
+  fclose(f);
+  return n;
+}
+
+int main(int argc, char *argv[]) {
+  sigset_t mask;
+  double phases[MAX_PHASES];
+  int n_phases = 0;
+
+  if(argc == 3 && strcmp(argv[1], "-f") == 0) {
+    n_phases = read_spec(argv[2], phases);
+  } else {
+    for(int i=1; i < argc && n_phases < MAX_PHASES; i++) {
+      phases[n_phases++] = atof(argv[i]);
+    }
+  }
+  // bursts and IOs alternate, starting and ending with a burst
+  if(n_phases <= 0 || n_phases % 2 == 0) {
+    printf("Usage: %s <burst> [<io> <burst>]... | -f <spec-file>\n", argv[0]);
+    exit(1);
+  }
+  for(int i=0; i < n_phases; i++) {
+    if(phases[i] < 0) {
+      printf("Invalid duration %g\n", phases[i]);
+      exit(1);
+    }
+  }
+
+  mypid = getpid();
+  snprintf(stop_msg, BUF_SIZE, "[pid %d] received a SIGUSR1 -> STOP\n", mypid);
+  snprintf(run_msg, BUF_SIZE, "[pid %d] received a SIGUSR2 -> RUN\n", mypid);
+  if(getenv(UT_ENV) != NULL && atoi(getenv(UT_ENV)) > 0) {
+    ut = atoi(getenv(UT_ENV));
+  }
+  if(getenv(PREEMPT_ENV) != NULL && strcmp(getenv(PREEMPT_ENV), "signal") != 0) {
+    cooperative = 0;
+  }
+
+  // SIGUSR2 may only interrupt wait_for_run()
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGUSR2);
+  sigprocmask(SIG_BLOCK, &mask, NULL);
+
+  signal(SIGUSR1, sigusr1_handler);
+  signal(SIGUSR2, sigusr2_handler);
+
+  // wait for a SIGUSR2 signal to start
+  // if we are not cooperative, the scheduler created us already stopped
+  if(cooperative) {
+    kill(mypid, SIGUSR1);
+  }
+
+  for(int i=0; i < n_phases; i++) {
+    if(i % 2 == 0) {
+      run_burst(phases[i]);
+    } else {
+      run_IO(phases[i]);
+    }
+  }
+}